@@ -1,9 +1,12 @@
 #include "CommandCompiler.h"
 #include "CommandScanner.h"
 #include "CommandVm.h"
+#include <algorithm>
 #include <cstdio>
 #include <cstdint>
 #include <fstream>
+#include <iomanip>
+#include <stdexcept>
 #include <glaze/glaze.hpp>
 #include <glaze/json/read.hpp>
 #include <iostream>
@@ -12,26 +15,155 @@ CommandCompiler::CommandCompiler(){}
 
 CommandCompiler::~CommandCompiler(){}
 
-void CommandCompiler::init(const char* path) {
+// converts a column inside the command string at commandStart into a file line/column
+static void locateInFile(const std::string& file, size_t commandStart, CompileError& error) {
+  const size_t pos = commandStart + error.column - 1;
+  int line = 1;
+  size_t lineStart = 0;
+  for (size_t i = 0; i < pos && i < file.size(); i++) {
+    if (file[i] == '\n') {
+      line++;
+      lineStart = i + 1;
+    }
+  }
+  error.line = line;
+  error.column = (int)(pos - lineStart) + 1;
+}
+
+void CommandCompiler::init(const char* path, CompileMode mode) {
+  init(path, arena, mode);
+}
+
+void CommandCompiler::init(const char* path, CommandArena* target, CompileMode mode) {
   std::ifstream configFile(path);
   if(!configFile)
     throw std::runtime_error("Failed to open file: " + std::string(path));
 
   std::string jsonBuff((std::istreambuf_iterator<char>(configFile)), std::istreambuf_iterator<char>());
   auto json = glz::read_json<RootJson>(jsonBuff);
-  
-  for(auto commandObj : json->commands){
-    printf("new command!\n");
-    compile(commandObj.command.c_str(), commandObj.clears);
+  if (!json)
+    throw std::runtime_error("Failed to parse " + std::string(path) + ": " + glz::format_error(json.error(), jsonBuff));
+
+  if (mode == COMPILE_VALIDATE) {
+    errors.clear();
+    size_t searchFrom = 0;
+    for (int i = 0; i < (int)json->commands.size(); i++) {
+      const std::string& command = json->commands[i].command;
+      const size_t errorsBefore = errors.size();
+      validate(command, i, errors);
+
+      // commands are parsed in file order, so the next "command" key holds this one
+      size_t found = jsonBuff.find("\"command\"", searchFrom);
+      if (found != std::string::npos) found = jsonBuff.find(command, found + 9);
+      if (found == std::string::npos) continue;
+      searchFrom = found + command.size();
+
+      for (size_t e = errorsBefore; e < errors.size(); e++) {
+        locateInFile(jsonBuff, found, errors[e]);
+      }
+    }
+
+    if (!errors.empty()) {
+      std::string report = "Invalid commands in " + std::string(path) + ":";
+      for (const CompileError& error : errors) {
+        report += "\n  " + std::string(path) + ":" + std::to_string(error.line) + ":" + std::to_string(error.column)
+          + ": \"" + json->commands[error.command].name + "\": " + error.message;
+      }
+      throw std::runtime_error(report);
+    }
+  }
+
+  // every instruction comes from a token of at least one char, plus OP_END
+  uint32_t capacity = 0;
+  for (const auto& commandObj : json->commands) {
+    capacity += commandObj.command.size() + 1;
+  }
+
+  // a caller arena can already hold other sets, fail before touching anything
+  if (target && target->capacity - target->size < capacity)
+    throw std::runtime_error("Command arena too small for " + std::string(path) + ": needs "
+                             + std::to_string(capacity) + ", has " + std::to_string(target->capacity - target->size));
+
+  CommandArena* const previousArena = arena;
+  const CommandSetView previousAttached = attached;
+  std::vector<CommandCode> previous = std::move(commands);
+  arena = target;
+  attached = CommandSetView{};
+  if (arena == nullptr) {
+    ownedStorage.assign(capacity, CommandIns{});
+    ownedArena = { nullptr, capacity, 0 };
+  }
+  const uint32_t start = activeArena().size;
+  commands.clear();
+  commands.reserve(json->commands.size());
+
+  try {
+    for(const auto& commandObj : json->commands){
+      compile(commandObj.command, commandObj.clears);
+    }
+  } catch (...) {
+    if (arena) arena->size = start;
+    arena = previousArena;
+    attached = previousAttached;
+    // unless the owned storage they pointed into was just reused
+    commands = (target || previousArena) ? std::move(previous) : std::vector<CommandCode>{};
+    throw;
   }
-  printf("done compiling commands\n");
+}
+
+void CommandCompiler::useArena(CommandArena* arena) {
+  this->arena = arena;
+  attached = CommandSetView{};
+  commands.clear();
+}
+
+void CommandCompiler::attach(const CommandSetView& view) {
+  attached = view;
+  commands.clear();
+}
+
+void CommandCompiler::reset() {
+  attached = CommandSetView{};
+  commands.clear();
+  activeArena().size = 0;
 }
 
 const CommandCode* CommandCompiler::getCommand(int index) const {
-  if (index < 0 || index >= commands.size())
+  if (index < 0 || index >= commandCount())
     throw std::runtime_error("trying to access out of bounds command");
 
-  return &commands[index];
+  return attached.codes ? &attached.codes[index] : &commands[index];
+}
+
+const CommandIns* CommandCompiler::getInstructions(const CommandCode* code) const {
+  const CommandIns* base = attached.codes ? attached.instructions
+    : arena ? arena->instructions : ownedStorage.data();
+  return base + code->offset;
+}
+
+const std::vector<CompileError>& CommandCompiler::getErrors() const {
+  return errors;
+}
+
+int CommandCompiler::commandCount() const {
+  return attached.codes ? attached.count : (int)commands.size();
+}
+
+CommandSetView CommandCompiler::view() const {
+  if (attached.codes) return attached;
+
+  CommandSetView set;
+  set.codes = commands.data();
+  set.instructions = arena ? arena->instructions : ownedStorage.data();
+  set.count = (int)commands.size();
+  return set;
+}
+
+CommandArena& CommandCompiler::activeArena() {
+  if (arena) return *arena;
+  // refreshed on every access so copies of the compiler never point at another's storage
+  ownedArena.instructions = ownedStorage.data();
+  return ownedArena;
 }
 
 std::string CommandCompiler::opcodeToString(CommandOp opcode) {
@@ -43,6 +175,7 @@ std::string CommandCompiler::opcodeToString(CommandOp opcode) {
     case OP_AND:      return "OP_AND";
     case OP_OR:       return "OP_OR";
     case OP_END:      return "OP_END";
+    case OP_CHORD:    return "OP_CHORD";
     default:          return "UNKNOWN_OP";
   }
 }
@@ -50,7 +183,9 @@ std::string CommandCompiler::opcodeToString(CommandOp opcode) {
 void CommandCompiler::printCode(const CommandCode& command) {
   std::cout << "=== Command Bytecode ===\n";
   
-  for (const auto& instruction : command.instructions) {
+  const CommandIns* instructions = getInstructions(&command);
+  for (uint32_t i = 0; i < command.length; i++) {
+    const CommandIns& instruction = instructions[i];
     std::cout << std::setw(12) << std::left << opcodeToString(instruction.opcode)
               << " Operand: 0x" << std::hex << std::setw(4) << std::setfill(' ') << instruction.operand
               << " (";
@@ -69,28 +204,35 @@ void CommandCompiler::printCode(const CommandCode& command) {
   std::cout << "========================\n";
 }
 
-void CommandCompiler::compile(const char* inputString, bool clears) {
-  // Create a new CommandCode to hold the bytecode instructions.
-  CommandCode code;
-  code.clears = clears;
+void CommandCompiler::compile(std::string_view source, bool clears) {
+  CommandArena& target = activeArena();
+  const uint32_t start = target.size;
 
-  std::vector<CommandToken> tokens = commandScanner.scan(inputString);
-  currentToken = &tokens[0];
+  commandScanner.init(source);
+  advance();
 
-  while (currentToken->type != CTOKEN_END) {
-    CommandCode subCode = compileNode();
-    code.instructions.insert(code.instructions.end(), subCode.instructions.begin(), subCode.instructions.end());
-    if (currentToken->type == CTOKEN_DELIM) {
-      currentToken++;
+  while (currentToken.type != CTOKEN_END) {
+    compileNode(target);
+    if (currentToken.type == CTOKEN_DELIM) {
+      advance();
     }
   }
   // we want to search from the end of a command first since its the latest button press
-  std::reverse(code.instructions.begin(), code.instructions.end());
-  code.instructions.push_back({ OP_END, 0 });
+  std::reverse(target.instructions + start, target.instructions + target.size);
+  emit(target, OP_END, 0);
+
+  commands.push_back({ start, target.size - start, clears });
+}
+
+void CommandCompiler::advance() {
+  currentToken = commandScanner.scanToken();
+}
+
+void CommandCompiler::emit(CommandArena& target, CommandOp opcode, uint32_t operand) {
+  if (target.size >= target.capacity)
+    throw std::runtime_error("command arena is full");
 
-  commands.push_back(code);
-  printf("Compiled command: %s\n", inputString);
-  printCode(code);
+  target.instructions[target.size++] = { opcode, operand };
 }
 
 auto precedence = [](CommandTokenType t) {
@@ -100,26 +242,49 @@ auto precedence = [](CommandTokenType t) {
     default:         return 0;
   }
 };
-// This function compiles a sequence of tokens into a CommandBytecode.
-CommandCode CommandCompiler::compileNode() {
-  CommandCode bytecode;
-  std::vector<CommandToken> expression;
-  std::vector<CommandIns> outputQueue;
-  std::vector<CommandOp>  opStack;
-
+// This function compiles one clause straight into the arena as postfix,
+// compile() reverses the whole command afterwards.
+void CommandCompiler::compileNode(CommandArena& target) {
+  CommandOp opStack[MAX_CLAUSE_OPS];
+  int opCount = 0;
 
   bool any = false,
   negate = false,
   held = false,
-  release = false;
+  release = false,
+  edge = false,
+  inChord = false;
+  uint32_t window = 0, chordMask = 0;
   // Process tokens until we hit a delimiter (CTOKEN_DELIM) or the end token.
-  while (currentToken->type != CTOKEN_DELIM && currentToken->type != CTOKEN_END) {
-    expression.push_back(*currentToken);
-    currentToken++;
-  }
-
-  for (const CommandToken &tok : expression) {
+  while (currentToken.type != CTOKEN_DELIM && currentToken.type != CTOKEN_END) {
+    const CommandToken& tok = currentToken;
     switch (tok.type) {
+      case CTOKEN_NUMBER:
+        // only chords use it, validate() rejects it on plain inputs
+        window = parseNumber(&tok);
+        break;
+      case CTOKEN_EDGE:
+        edge = true;
+        break;
+      case CTOKEN_CHORD_START:
+        inChord = true;
+        chordMask = 0;
+        break;
+      case CTOKEN_CHORD_END: {
+        if (!inChord) break;
+        if (window == 0) window = CHORD_DEFAULT_WINDOW;
+        if (window > CHORD_MAX_WINDOW) window = CHORD_MAX_WINDOW;
+
+        uint32_t operand = chordMask | ((window - 1) << CHORD_WINDOW_SHIFT);
+        if (release) operand |= CHORD_RELEASE_FLAG;
+        if (edge) operand |= CHORD_EDGE_FLAG;
+        if (negate) operand |= NOT_FLAG;
+
+        emit(target, OP_CHORD, operand);
+        any = negate = held = release = edge = inChord = false;
+        window = 0;
+        break;
+      }
       case CTOKEN_ANY:
         any = true;
         break;
@@ -135,7 +300,13 @@ CommandCode CommandCompiler::compileNode() {
       case CTOKEN_NEUTRAL: case CTOKEN_FORWARD: case CTOKEN_BACK:
       case CTOKEN_UP: case CTOKEN_DOWN: case CTOKEN_UPFORWARD:
       case CTOKEN_UPBACK: case CTOKEN_DOWNFORWARD: case CTOKEN_DOWNBACK:
-      case CTOKEN_LP: case CTOKEN_LK: case CTOKEN_MP: case CTOKEN_MK: {
+      case CTOKEN_LP: case CTOKEN_LK: case CTOKEN_MP: case CTOKEN_MK:
+      case CTOKEN_HP: case CTOKEN_HK: case CTOKEN_AP: case CTOKEN_AK:
+      case CTOKEN_START: case CTOKEN_SELECT: case CTOKEN_MISC1: case CTOKEN_MISC2: {
+        if (inChord) {
+          chordMask |= parseInputMask(&tok);
+          break;
+        }
         CommandOp op = OP_PRESS;
         if (held) op = OP_HOLD;
         if (release) op = OP_RELEASE;
@@ -144,12 +315,14 @@ CommandCode CommandCompiler::compileNode() {
         if (any) operand |= ANY_FLAG;
         if (negate) operand |= NOT_FLAG;
 
-        outputQueue.push_back({ op, operand });
+        emit(target, op, operand);
         // clear flags
         any = false;
         negate = false;
         held = false;
         release = false;
+        edge = false;
+        window = 0;
         break;
       }
       // — OPERATORS: handle '&' and '|' by precedence
@@ -158,34 +331,190 @@ CommandCode CommandCompiler::compileNode() {
         CommandOp thisOp = (tok.type == CTOKEN_AND ? OP_AND : OP_OR);
         int thisPrec = precedence(tok.type);
 
-        while (!opStack.empty()) {
+        while (opCount > 0) {
           // top op baby
-          CommandOp topOp = opStack.back();
+          CommandOp topOp = opStack[opCount - 1];
           // top tok babbyy
           CommandTokenType topTok = (topOp == OP_AND ? CTOKEN_AND : topOp == OP_OR  ? CTOKEN_OR : CTOKEN_END);
           if (precedence(topTok) >= thisPrec) {
             // finegle the bagle
-            outputQueue.push_back({ topOp, 0 });
-            opStack.pop_back();
+            emit(target, topOp, 0);
+            opCount--;
           } else {
             break;
           }
         }
         // push the new operator
-        opStack.push_back(thisOp);
+        if (opCount >= MAX_CLAUSE_OPS)
+          throw std::runtime_error("too many operators in one command clause");
+        opStack[opCount++] = thisOp;
         break;
       }
 
       default:
         break;
     }
+    advance();
+  }
+
+  while (opCount > 0) {
+    emit(target, opStack[--opCount], 0);
+  }
+}
+
+static std::string describeToken(const CommandToken& token) {
+  switch (token.type) {
+    case CTOKEN_END:   return "end of command";
+    case CTOKEN_DELIM: return "','";
+    default:           return "'" + std::string(token.lexeme()) + "'";
   }
+}
+
+// Slow path for files that haven't been checked yet, compile() never calls this.
+// Keeps going after an error so a single pass reports every bad clause.
+bool CommandCompiler::validate(std::string_view source, int commandIndex, std::vector<CompileError>& errors) {
+  const size_t errorsBefore = errors.size();
+  CommandScanner scanner;
+  scanner.init(source);
+
+  auto report = [&](const CommandToken& token, const std::string& message) {
+    errors.push_back({ commandIndex, 0, scanner.tokenOffset(token) + 1, message });
+  };
+
+  bool expectInput = true,  // start of a clause or right after '&' / '|'
+  clauseEmpty = true,
+  modified = false,         // a frame count or modifier is waiting for its input
+  held = false,
+  released = false,
+  any = false,
+  edge = false,
+  inChord = false,
+  counted = false,
+  skipClause = false;
+  uint32_t frameCount = 0;
+  int chordInputs = 0;
+
+  for (;;) {
+    const CommandToken token = scanner.scanToken();
+
+    if (token.type == CTOKEN_DELIM || token.type == CTOKEN_END) {
+      if (!skipClause) {
+        if (inChord) report(token, "expected ']' before " + describeToken(token));
+        else if (clauseEmpty) report(token, "empty clause before " + describeToken(token));
+        else if (expectInput) report(token, "expected an input before " + describeToken(token));
+      }
+      if (token.type == CTOKEN_END) break;
+
+      expectInput = true;
+      clauseEmpty = true;
+      modified = held = released = any = edge = inChord = counted = skipClause = false;
+      frameCount = 0;
+      continue;
+    }
+    if (skipClause) continue;
+    clauseEmpty = false;
+
+    if (inChord && token.type != CTOKEN_CHORD_END && !isInputToken(token.type) && token.type != CTOKEN_ERROR) {
+      report(token, "only inputs can go inside a chord, put modifiers before '[' (got " + describeToken(token) + ")");
+      skipClause = true;
+      continue;
+    }
 
-  while (!opStack.empty()) {
-    outputQueue.push_back({ opStack.back(), 0 });
-    opStack.pop_back();
+    switch (token.type) {
+      case CTOKEN_ERROR:
+        report(token, (scanner.isAlpha(token.start[0]) ? "unknown input " : "unexpected character ") + describeToken(token));
+        skipClause = true;
+        break;
+      case CTOKEN_NUMBER:
+        if (!expectInput || modified) {
+          report(token, "frame count " + describeToken(token) + " must come before the input and its modifiers");
+          skipClause = true;
+        }
+        frameCount = parseNumber(&token);
+        counted = true;
+        modified = true;
+        break;
+      case CTOKEN_RELEASED:
+      case CTOKEN_HELD:
+      case CTOKEN_ANY:
+      case CTOKEN_NOT:
+      case CTOKEN_EDGE:
+        if (!expectInput) {
+          report(token, "expected '&', '|' or ',' before " + describeToken(token));
+          skipClause = true;
+        }
+        held |= token.type == CTOKEN_HELD;
+        released |= token.type == CTOKEN_RELEASED;
+        any |= token.type == CTOKEN_ANY;
+        edge |= token.type == CTOKEN_EDGE;
+        if (held && released) {
+          report(token, "'~' and '*' can't be combined on one input");
+          skipClause = true;
+        } else if (edge && released) {
+          report(token, "'~' and '^' can't be combined on one chord");
+          skipClause = true;
+        }
+        modified = true;
+        break;
+      case CTOKEN_AND:
+      case CTOKEN_OR:
+        if (expectInput) {
+          report(token, "expected an input before " + describeToken(token));
+          skipClause = true;
+        }
+        expectInput = true;
+        break;
+      case CTOKEN_CHORD_START:
+        if (!expectInput) {
+          report(token, "expected '&', '|' or ',' before " + describeToken(token));
+          skipClause = true;
+        } else if (held || any) {
+          report(token, std::string(held ? "'*'" : "'@'") + " can't be used on a chord");
+          skipClause = true;
+        } else if (counted && (frameCount == 0 || frameCount > CHORD_MAX_WINDOW)) {
+          report(token, "chord window must be 1-" + std::to_string(CHORD_MAX_WINDOW) + " frames");
+          skipClause = true;
+        }
+        inChord = true;
+        chordInputs = 0;
+        break;
+      case CTOKEN_CHORD_END:
+        if (!inChord) {
+          report(token, "']' without a matching '['");
+          skipClause = true;
+          break;
+        }
+        if (chordInputs == 0) {
+          report(token, "empty chord");
+          skipClause = true;
+        }
+        inChord = false;
+        expectInput = false;
+        modified = held = released = any = edge = counted = false;
+        frameCount = 0;
+        break;
+      default:
+        if (inChord) {
+          chordInputs++;
+          break;
+        }
+        if (!expectInput) {
+          report(token, "expected '&', '|' or ',' before " + describeToken(token));
+          skipClause = true;
+        } else if (edge) {
+          report(token, "'^' only applies to chords, e.g. ^[LP LK]");
+          skipClause = true;
+        } else if (counted) {
+          // compile() has nothing to do with it, don't let it look meaningful
+          report(token, "frame count only applies to chords, e.g. 3[LP LK]");
+          skipClause = true;
+        }
+        expectInput = false;
+        modified = held = released = any = edge = counted = false;
+        frameCount = 0;
+        break;
+    }
   }
-  bytecode.instructions = std::move(outputQueue);
 
-  return bytecode;
+  return errors.size() == errorsBefore;
 }
@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 #include "CommandScanner.h"
 #include "CommandVm.h"
@@ -20,21 +21,68 @@ struct RootJson {
   std::vector<CommandJson> commands;
 };
 
+enum CompileMode : uint8_t {
+  COMPILE_VALIDATE, // check every command first, a bad file changes nothing
+  COMPILE_TRUSTED,  // already validated data, straight into the arena
+};
+
+struct CompileError {
+  int command;  // index into the file's "commands" array
+  int line;     // 1-based, 0 when the command couldn't be located in the file
+  int column;   // 1-based, relative to the command string when line is 0
+  std::string message;
+};
+
+// operators ('&', '|') allowed in a single comma-separated clause
+constexpr int MAX_CLAUSE_OPS{ 32 };
+
 class CommandCompiler {
 public:
   CommandCompiler();
   ~CommandCompiler();
 
-  void init(const char* path);
+  // Without a caller arena, init() sizes an internal one once from the file.
+  // With one, commands are appended to it and the caller owns resetting arena->size.
+  // In COMPILE_VALIDATE mode every error in the file is collected and init() throws
+  // before touching the current commands. With a caller arena, a file that doesn't
+  // fit or fails to compile leaves the arena and the current commands as they were.
+  void init(const char* path, CompileMode mode = COMPILE_VALIDATE);
+  void init(const char* path, CommandArena* arena, CompileMode mode = COMPILE_VALIDATE);
+  void useArena(CommandArena* arena);
+  // Serves an already compiled, read-only set instead of compiling one.
+  // The view has to outlive the compiler; init(), useArena() or reset() detaches it.
+  void attach(const CommandSetView& view);
+
+  // Appends one command to the active arena, no per-command heap allocation.
+  // Assumes valid input, unknown tokens are ignored.
+  void compile(std::string_view source, bool clears);
+  // Checks one command, appending what's wrong to errors (line 0, column into source).
+  bool validate(std::string_view source, int commandIndex, std::vector<CompileError>& errors);
+  const std::vector<CompileError>& getErrors() const;
+  // Forgets compiled commands, keeping every buffer's capacity.
+  void reset();
+
   const CommandCode* getCommand(int index) const;
+  const CommandIns* getInstructions(const CommandCode* code) const;
+  int commandCount() const;
+  // the compiled set as a read-only view, valid until the next init/compile/reset
+  CommandSetView view() const;
   std::string opcodeToString(CommandOp opcode);
+  // debug dump of one command's bytecode to stdout, never called on load
+  void printCode(const CommandCode& code);
 
 private:
-  void compile(const char* inputString, bool clears);
-  CommandCode compileNode();
-  void printCode(const CommandCode& code);
+  void compileNode(CommandArena& target);
+  void advance();
+  void emit(CommandArena& target, CommandOp opcode, uint32_t operand);
+  CommandArena& activeArena();
 
   std::vector<CommandCode> commands;
+  std::vector<CompileError> errors;
+  CommandSetView attached;       // codes is null unless attach() was called
+  CommandArena* arena = nullptr; // caller-provided, null when using ownedStorage
+  CommandArena ownedArena;
+  std::vector<CommandIns> ownedStorage;
   CommandScanner commandScanner;
-  CommandToken* currentToken;
+  CommandToken currentToken;
 };
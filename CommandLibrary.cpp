@@ -0,0 +1,227 @@
+#include "CommandLibrary.h"
+#include "CommandCompiler.h"
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static uint32_t fnv1a(const uint8_t* data, size_t size) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= data[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+// The checksum only proves the segment is what was published. The VM indexes
+// codes and instructions without bounds checks, so the tables have to agree too.
+static bool tablesConsistent(const uint8_t* bytes, const CommandLibraryHeader& h) {
+  CommandLibraryCharacter character;
+  for (uint32_t i = 0; i < h.characterCount; i++) {
+    std::memcpy(&character, bytes + h.charactersOffset + (size_t)i * sizeof(character), sizeof(character));
+    if ((uint64_t)character.firstCommand + character.commandCount > h.commandCount) return false;
+  }
+
+  CommandCode code;
+  CommandIns ins;
+  for (uint32_t i = 0; i < h.commandCount; i++) {
+    std::memcpy(&code, bytes + h.codesOffset + (size_t)i * sizeof(code), sizeof(code));
+    if (code.length == 0 || (uint64_t)code.offset + code.length > h.instructionCount) return false;
+
+    // Every clause has to be a whole prefix expression and the command has to end on
+    // OP_END, or evalPrefix walks off into the next command.
+    const uint8_t* first = bytes + h.instructionsOffset + (size_t)code.offset * sizeof(ins);
+    int pending = 0;
+    for (uint32_t j = 0; j < code.length; j++) {
+      std::memcpy(&ins, first + (size_t)j * sizeof(ins), sizeof(ins));
+      if (j == code.length - 1) {
+        if (ins.opcode != OP_END || pending != 0) return false;
+        break;
+      }
+      if (ins.opcode == OP_END || ins.opcode > OP_CHORD) return false;
+      if (pending == 0) pending = 1; // a new clause
+      pending += (ins.opcode == OP_AND || ins.opcode == OP_OR) ? 1 : -1;
+    }
+  }
+  return true;
+}
+
+static uint32_t alignUp(size_t value) {
+  return (uint32_t)((value + 7) & ~size_t(7));
+}
+
+CommandLibrary::CommandLibrary(){}
+
+CommandLibrary::CommandLibrary(CommandLibrary&& other)
+  : segment(other.segment), segmentSize(other.segmentSize) {
+  other.segment = nullptr;
+  other.segmentSize = 0;
+}
+
+CommandLibrary& CommandLibrary::operator=(CommandLibrary&& other) {
+  if (this != &other) {
+    detach();
+    segment = other.segment;
+    segmentSize = other.segmentSize;
+    other.segment = nullptr;
+    other.segmentSize = 0;
+  }
+  return *this;
+}
+
+CommandLibrary::~CommandLibrary(){
+  detach();
+}
+
+void CommandLibrary::publish(const char* segmentName, const std::vector<RosterEntry>& roster) {
+  std::vector<CommandLibraryCharacter> characters;
+  std::vector<CommandCode> codes;
+  std::vector<CommandIns> instructions;
+
+  CommandCompiler compiler;
+  for (const RosterEntry& entry : roster) {
+    if (entry.name.size() >= CHARACTER_NAME_LENGTH)
+      throw std::runtime_error("Character name too long for the command library: " + entry.name);
+
+    compiler.init(entry.path.c_str(), COMPILE_VALIDATE);
+
+    CommandLibraryCharacter character{};
+    std::memcpy(character.name, entry.name.data(), entry.name.size());
+    character.firstCommand = (uint32_t)codes.size();
+    character.commandCount = (uint32_t)compiler.commandCount();
+
+    // rebase every command onto the library's single instruction block
+    for (int i = 0; i < compiler.commandCount(); i++) {
+      const CommandCode* code = compiler.getCommand(i);
+      const CommandIns* ins = compiler.getInstructions(code);
+      codes.push_back({ (uint32_t)instructions.size(), code->length, code->clears });
+      instructions.insert(instructions.end(), ins, ins + code->length);
+    }
+    characters.push_back(character);
+  }
+
+  CommandLibraryHeader header{};
+  header.magic = COMMAND_LIBRARY_MAGIC;
+  header.version = COMMAND_LIBRARY_VERSION;
+  header.bytecodeVersion = COMMAND_BYTECODE_VERSION;
+  header.characterCount = (uint32_t)characters.size();
+  header.commandCount = (uint32_t)codes.size();
+  header.instructionCount = (uint32_t)instructions.size();
+  header.charactersOffset = alignUp(sizeof(header));
+  header.codesOffset = alignUp(header.charactersOffset + characters.size() * sizeof(CommandLibraryCharacter));
+  header.instructionsOffset = alignUp(header.codesOffset + codes.size() * sizeof(CommandCode));
+  header.totalSize = alignUp(header.instructionsOffset + instructions.size() * sizeof(CommandIns));
+
+  std::vector<uint8_t> image(header.totalSize, 0);
+  std::memcpy(image.data() + header.charactersOffset, characters.data(), characters.size() * sizeof(CommandLibraryCharacter));
+  std::memcpy(image.data() + header.codesOffset, codes.data(), codes.size() * sizeof(CommandCode));
+  std::memcpy(image.data() + header.instructionsOffset, instructions.data(), instructions.size() * sizeof(CommandIns));
+  header.checksum = fnv1a(image.data() + sizeof(header), image.size() - sizeof(header));
+  std::memcpy(image.data(), &header, sizeof(header));
+
+  // unlink first so processes still attached keep the old segment untouched
+  shm_unlink(segmentName);
+  int fd = shm_open(segmentName, O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0)
+    throw std::runtime_error("Failed to create command library: " + std::string(segmentName));
+
+  if (ftruncate(fd, image.size()) != 0) {
+    close(fd);
+    shm_unlink(segmentName);
+    throw std::runtime_error("Failed to size command library: " + std::string(segmentName));
+  }
+
+  void* mapped = mmap(nullptr, image.size(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    shm_unlink(segmentName);
+    throw std::runtime_error("Failed to map command library: " + std::string(segmentName));
+  }
+
+  std::memcpy(mapped, image.data(), image.size());
+  munmap(mapped, image.size());
+}
+
+void CommandLibrary::unpublish(const char* segmentName) {
+  shm_unlink(segmentName);
+}
+
+void CommandLibrary::attach(const char* segmentName) {
+  detach();
+
+  int fd = shm_open(segmentName, O_RDONLY, 0);
+  if (fd < 0)
+    throw std::runtime_error("Failed to open command library: " + std::string(segmentName));
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(CommandLibraryHeader)) {
+    close(fd);
+    throw std::runtime_error("Command library is truncated: " + std::string(segmentName));
+  }
+
+  const size_t size = info.st_size;
+  void* mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED)
+    throw std::runtime_error("Failed to map command library: " + std::string(segmentName));
+
+  const uint8_t* bytes = static_cast<const uint8_t*>(mapped);
+  CommandLibraryHeader h;
+  std::memcpy(&h, bytes, sizeof(h));
+
+  const bool valid = h.magic == COMMAND_LIBRARY_MAGIC
+    && h.version == COMMAND_LIBRARY_VERSION
+    // an older process can't run opcodes it doesn't know
+    && h.bytecodeVersion == COMMAND_BYTECODE_VERSION
+    && h.totalSize == size
+    && h.charactersOffset + (size_t)h.characterCount * sizeof(CommandLibraryCharacter) <= size
+    && h.codesOffset + (size_t)h.commandCount * sizeof(CommandCode) <= size
+    && h.instructionsOffset + (size_t)h.instructionCount * sizeof(CommandIns) <= size
+    && h.checksum == fnv1a(bytes + sizeof(h), size - sizeof(h))
+    && tablesConsistent(bytes, h);
+
+  if (!valid) {
+    munmap(mapped, size);
+    throw std::runtime_error("Command library failed validation: " + std::string(segmentName));
+  }
+
+  segment = bytes;
+  segmentSize = size;
+}
+
+void CommandLibrary::detach() {
+  if (segment) munmap(const_cast<uint8_t*>(segment), segmentSize);
+  segment = nullptr;
+  segmentSize = 0;
+}
+
+const CommandLibraryHeader* CommandLibrary::header() const {
+  return reinterpret_cast<const CommandLibraryHeader*>(segment);
+}
+
+CommandSetView CommandLibrary::getCharacter(const char* name) const {
+  if (!segment)
+    throw std::runtime_error("Command library is not attached");
+
+  const CommandLibraryHeader* h = header();
+  const CommandLibraryCharacter* characters =
+    reinterpret_cast<const CommandLibraryCharacter*>(segment + h->charactersOffset);
+
+  for (uint32_t i = 0; i < h->characterCount; i++) {
+    if (std::strncmp(characters[i].name, name, CHARACTER_NAME_LENGTH) == 0) {
+      CommandSetView view;
+      view.codes = reinterpret_cast<const CommandCode*>(segment + h->codesOffset) + characters[i].firstCommand;
+      view.instructions = reinterpret_cast<const CommandIns*>(segment + h->instructionsOffset);
+      view.count = (int)characters[i].commandCount;
+      return view;
+    }
+  }
+  throw std::runtime_error("Character not in command library: " + std::string(name));
+}
+
+int CommandLibrary::characterCount() const {
+  return segment ? (int)header()->characterCount : 0;
+}
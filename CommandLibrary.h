@@ -0,0 +1,75 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "CommandVm.h"
+
+// Compiled command sets for a whole roster in one named, read-only POSIX
+// shared memory segment. One process publishes, every match process attaches
+// and points its controllers at the shared instructions instead of compiling.
+//
+// Segment layout, every offset relative to the start of the segment:
+//   CommandLibraryHeader
+//   CommandLibraryCharacter[characterCount]
+//   CommandCode[commandCount]   offsets index the instruction block
+//   CommandIns[instructionCount]
+
+constexpr uint32_t COMMAND_LIBRARY_MAGIC{ 0x4C434356 }; // "VCCL"
+constexpr uint32_t COMMAND_LIBRARY_VERSION{ 2 }; // segment layout, the bytecode has its own version
+constexpr int CHARACTER_NAME_LENGTH{ 32 };
+
+struct CommandLibraryHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t bytecodeVersion; // COMMAND_BYTECODE_VERSION the instructions were compiled for
+  uint32_t totalSize;
+  uint32_t checksum; // FNV-1a of everything after the header
+  uint32_t characterCount;
+  uint32_t commandCount;
+  uint32_t instructionCount;
+  uint32_t charactersOffset;
+  uint32_t codesOffset;
+  uint32_t instructionsOffset;
+};
+
+struct CommandLibraryCharacter {
+  char name[CHARACTER_NAME_LENGTH];
+  uint32_t firstCommand;
+  uint32_t commandCount;
+};
+
+struct RosterEntry {
+  std::string name; // at most CHARACTER_NAME_LENGTH - 1 chars
+  std::string path; // that character's commands.json
+};
+
+class CommandLibrary {
+public:
+  CommandLibrary();
+  CommandLibrary(CommandLibrary&& other);
+  CommandLibrary& operator=(CommandLibrary&& other);
+  CommandLibrary(const CommandLibrary&) = delete;
+  CommandLibrary& operator=(const CommandLibrary&) = delete;
+  ~CommandLibrary();
+
+  // Compiles (validated) every roster entry and writes the segment, replacing
+  // any segment with the same name. Throws on any bad file.
+  static void publish(const char* segmentName, const std::vector<RosterEntry>& roster);
+  static void unpublish(const char* segmentName);
+
+  // Maps the segment read-only and checks magic, versions, size, checksum and that
+  // every character, command and clause stays inside its table.
+  void attach(const char* segmentName);
+  void detach();
+
+  // throws if the character isn't in the library
+  CommandSetView getCharacter(const char* name) const;
+  int characterCount() const;
+
+private:
+  const CommandLibraryHeader* header() const;
+
+  const uint8_t* segment = nullptr;
+  size_t segmentSize = 0;
+};
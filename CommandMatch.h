@@ -0,0 +1,168 @@
+#pragma once
+#include <cstdint>
+#include "CircularBuffer.h"
+#include "CommandVm.h"
+#include "EventHistory.h"
+#include "Input.h"
+
+// The primitives behind OP_PRESS / OP_RELEASE / OP_HOLD / OP_CHORD, shared by the
+// bytecode VM and the matchers tools/CommandCodegen.cpp generates. Everything is
+// inline so a generated matcher gets them folded against its constant operands.
+
+#ifdef VC_EVENT_HISTORY
+#define MATCH_HISTORY_NAMESPACE event_history
+#else
+#define MATCH_HISTORY_NAMESPACE frame_history
+#endif
+
+// Declares a set from a generated file, e.g. DECLARE_GENERATED_COMMANDS(ryuCommands);
+#define DECLARE_GENERATED_COMMANDS(symbol) \
+  inline namespace MATCH_HISTORY_NAMESPACE { extern const GeneratedCommandSet symbol; }
+
+// Everything here depends on the history layout, so it's named after it. A file
+// built with the other VC_EVENT_HISTORY setting then doesn't link, instead of the
+// linker keeping one mode's copy of these inline functions for both.
+inline namespace MATCH_HISTORY_NAMESPACE {
+
+#ifdef VC_EVENT_HISTORY
+using InputHistory = EventHistory;
+#else
+using InputHistory = CircularBuffer;
+#endif
+
+constexpr int MATCH_SCAN_FRAMES{ 16 }; // how far back a press / release is searched for
+
+// One checkCommand's view of the controller plus what the match left behind.
+struct MatchContext {
+  InputHistory& history;
+  uint32_t currentState;
+  const uint32_t* pressedWindow;  // see VirtualController::pressedWindow
+  const uint32_t* releasedWindow;
+
+  int frameOffset = 0;        // offset of the newest clause that still has to match
+  int latency = -1;           // offset the first clause matched at, the command's last input
+  int ip = 0;                 // instruction the command stopped at
+  uint32_t skipped = 0;       // instructions passed over by a short-circuit '&'
+  uint32_t framesProbed = 0;  // history frames looked at
+};
+
+using CommandMatcher = bool (*)(MatchContext& ctx);
+
+// A move list compiled ahead of time, see tools/CommandCodegen.cpp.
+struct GeneratedCommandSet {
+  const CommandMatcher* matchers; // same indices as CommandCompiler::getCommand
+  CommandSetView bytecode;        // what the matchers were generated from
+  const char* source;             // commands.json path at generation time
+};
+
+inline bool matchStrict(uint32_t bitsToCheck, uint32_t query) {
+  // Extract the directional and button parts from the query.
+  const uint32_t queryDir = query & Input::DIR_MASK;
+  const uint32_t queryBtn = query & Input::BTN_MASK;
+
+  // Check directional bits if any were provided.
+  bool dirMatch = (queryDir == 0) || ((bitsToCheck & Input::DIR_MASK) == queryDir);
+  // Check button bits if any were provided.
+  bool btnMatch = (queryBtn == 0) || ((bitsToCheck & Input::BTN_MASK) == queryBtn);
+
+  return dirMatch && btnMatch;
+}
+
+inline bool matchFrame(const InputFrame& frame, uint32_t input, bool strict, bool pressed) {
+  const uint32_t targetMask = pressed ? frame.pressedBits : frame.releasedBits;
+  return strict ? matchStrict(targetMask, input) : (targetMask & input) != 0;
+}
+
+inline bool matchHeld(uint32_t currentState, uint32_t input, bool strict) {
+  return strict ? matchStrict(currentState, input) : (currentState & input) != 0;
+}
+
+// First offset in [startOffset, buffLen) pressing / releasing input, or -1.
+inline int matchFind(MatchContext& ctx, uint32_t input, bool strict, bool pressed, int startOffset,
+                     int buffLen = MATCH_SCAN_FRAMES) {
+#ifdef VC_EVENT_HISTORY
+  return ctx.history.find([&](const InputFrame& frame) {
+    return matchFrame(frame, input, strict, pressed);
+  }, startOffset, buffLen, &ctx.framesProbed);
+#else
+  if (buffLen > MAX_HISTORY) buffLen = MAX_HISTORY;
+  for (int i = startOffset; i < buffLen; ++i) {
+    if (matchFrame(ctx.history[i], input, strict, pressed)) {
+      ctx.framesProbed += i - startOffset + 1;
+      return i;
+    }
+  }
+  if (buffLen > startOffset) ctx.framesProbed += buffLen - startOffset;
+  return -1;
+#endif
+}
+
+inline uint32_t chordBits(const InputFrame& frame, bool release, bool edge) {
+  uint32_t bits = release ? frame.releasedBits : frame.pressedBits;
+  if (edge) bits |= frame.releasedBits;
+  return bits;
+}
+
+// Offset in [startOffset, buffLen) where the chord completed, or -1. That's the
+// newest frame with one of its inputs from which every input shows up within
+// the window, so older clauses are searched from there like after a press.
+// Completing on the current frame, the usual case for a chord ending the
+// command, is one compare against the window masks.
+inline int matchChord(MatchContext& ctx, uint32_t operand, int startOffset, int buffLen = MATCH_SCAN_FRAMES) {
+  const uint32_t chord = operand & CHORD_INPUT_MASK;
+  const int window = ((operand & CHORD_WINDOW_MASK) >> CHORD_WINDOW_SHIFT) + 1;
+  const bool release = (operand & CHORD_RELEASE_FLAG) != 0;
+  const bool edge = (operand & CHORD_EDGE_FLAG) != 0;
+
+  if (buffLen > MAX_HISTORY) buffLen = MAX_HISTORY;
+  int offset = startOffset;
+  if (offset == 0) {
+    uint32_t newest = release ? ctx.releasedWindow[0] : ctx.pressedWindow[0];
+    uint32_t seen = release ? ctx.releasedWindow[window - 1] : ctx.pressedWindow[window - 1];
+    if (edge) {
+      newest |= ctx.releasedWindow[0];
+      seen |= ctx.releasedWindow[window - 1];
+    }
+    ctx.framesProbed++;
+    if ((newest & chord) != 0 && (seen & chord) == chord) return 0;
+    offset = 1;
+  }
+
+#ifdef VC_EVENT_HISTORY
+  // empty frames add no bits, so only events can start or fill a chord. One walk
+  // newest first like EventHistory::find, history[i] would walk the ring every time.
+  const EventHistory& history = ctx.history;
+  for (int e = 0; e < history.count; e++) {
+    const InputEvent& event = history.events[(history.next - 1 - e) & (MAX_EVENTS - 1)];
+    const int eventOffset = (int)(history.frame - event.frame);
+    if (eventOffset < offset) continue;
+    if (eventOffset >= buffLen) break;
+    uint32_t seen = chordBits(InputFrame{ event.pressedBits, event.releasedBits, 0 }, release, edge);
+    ctx.framesProbed++;
+    if ((seen & chord) == 0) continue;
+    for (int o = e + 1; o < history.count; o++) {
+      const InputEvent& older = history.events[(history.next - 1 - o) & (MAX_EVENTS - 1)];
+      const int olderOffset = (int)(history.frame - older.frame);
+      if (olderOffset >= eventOffset + window || olderOffset >= MAX_HISTORY) break;
+      seen |= chordBits(InputFrame{ older.pressedBits, older.releasedBits, 0 }, release, edge);
+      ctx.framesProbed++;
+    }
+    if ((seen & chord) == chord) return eventOffset;
+  }
+  return -1;
+#else
+  for (; offset < buffLen; offset++) {
+    uint32_t seen = chordBits(ctx.history[offset], release, edge);
+    ctx.framesProbed++;
+    if ((seen & chord) == 0) continue;
+    for (int i = offset + 1; i < offset + window && i < MAX_HISTORY; i++) {
+      seen |= chordBits(ctx.history[i], release, edge);
+      ctx.framesProbed++;
+    }
+    if ((seen & chord) == chord) return offset;
+  }
+  return -1;
+#endif
+}
+
+} // namespace MATCH_HISTORY_NAMESPACE
@@ -1,121 +1,123 @@
 #include "CommandScanner.h"
+#include <cstring>
 
 CommandScanner::CommandScanner(){};
 CommandScanner::~CommandScanner(){};
 
-std::vector<CommandToken> CommandScanner::scan(const char* inputString) {
-  scannerStart = inputString;
+void CommandScanner::init(std::string_view source) {
+  sourceStart = source.data();
+  scannerStart = source.data();
   scannerCurrent = scannerStart;
-  std::vector<CommandToken> returnVect;
+  scannerEnd = scannerStart + source.size();
+}
 
-  while(!isAtEnd()){
+CommandToken CommandScanner::scanToken() {
+  for (;;) {
     skipWhitespace();
     scannerStart = scannerCurrent;
+    if (isAtEnd()) return makeToken(CTOKEN_END);
+
     char c = advance();
 
     if (isAlpha(c)){
-      while(isAlpha(peek())){
+      while(isAlpha(peek()) || isDigit(peek())){
         advance();
       }
-
-      returnVect.push_back(makeToken(getInputType()));
-      scannerStart = scannerCurrent;
+      return makeToken(getInputType());
     };
 
     if (isDigit(c)){
       while(isDigit(peek())){
         advance();
       }
-
-      returnVect.push_back(makeToken(CTOKEN_NUMBER));
-      scannerStart = scannerCurrent;
+      return makeToken(CTOKEN_NUMBER);
     };
 
     switch (c) {
-      case '~': 
-        returnVect.push_back(makeToken(CTOKEN_RELEASED)); 
-        scannerStart = scannerCurrent;
-        break;
-      case '*': 
-        returnVect.push_back(makeToken(CTOKEN_HELD));
-        scannerStart = scannerCurrent;
-        break;
-      case '@': 
-        returnVect.push_back(makeToken(CTOKEN_ANY));
-        scannerStart = scannerCurrent;
-        break;
-      case '!': 
-        returnVect.push_back(makeToken(CTOKEN_NOT));
-        scannerStart = scannerCurrent;
-        break;
-      case '&': 
-        returnVect.push_back(makeToken(CTOKEN_AND));
-        scannerStart = scannerCurrent;
-        break;
-      case '|': 
-        returnVect.push_back(makeToken(CTOKEN_OR));
-        scannerStart = scannerCurrent;
-        break;
-      case ',':
-        returnVect.push_back(makeToken(CTOKEN_DELIM));
-        scannerStart = scannerCurrent;
-        break;
+      case '~': return makeToken(CTOKEN_RELEASED);
+      case '*': return makeToken(CTOKEN_HELD);
+      case '@': return makeToken(CTOKEN_ANY);
+      case '!': return makeToken(CTOKEN_NOT);
+      case '&': return makeToken(CTOKEN_AND);
+      case '|': return makeToken(CTOKEN_OR);
+      case ',': return makeToken(CTOKEN_DELIM);
+      case '[': return makeToken(CTOKEN_CHORD_START);
+      case ']': return makeToken(CTOKEN_CHORD_END);
+      case '^': return makeToken(CTOKEN_EDGE);
     }
+    return makeToken(CTOKEN_ERROR);
   }
-
-  returnVect.push_back(makeToken(CTOKEN_END));
-  return returnVect;
 }
 
+// keywords must match exactly, "DOWN" or "HPX" are errors rather than a guess
 CommandTokenType CommandScanner::getInputType() {
+  const bool compound = scannerCurrent - scannerStart > 1;
+
   switch (scannerStart[0]) {
-    case 'N': return CTOKEN_NEUTRAL;
-              break;
-    case 'F': return CTOKEN_FORWARD;
-              break;
-    case 'B': return CTOKEN_BACK;
-              break;
-    case 'U': { 
-      if (scannerCurrent - scannerStart > 1) {
+    case 'N': return checkKeyword(1, 0, "", CTOKEN_NEUTRAL);
+    case 'F': return checkKeyword(1, 0, "", CTOKEN_FORWARD);
+    case 'B': return checkKeyword(1, 0, "", CTOKEN_BACK);
+    case 'U': {
+      if (compound) {
         switch (scannerStart[1]) {
-          case 'F': return CTOKEN_UPFORWARD;
-          case 'B': return CTOKEN_UPBACK;
+          case 'F': return checkKeyword(2, 0, "", CTOKEN_UPFORWARD);
+          case 'B': return checkKeyword(2, 0, "", CTOKEN_UPBACK);
         }
       }
-      return CTOKEN_UP;
+      return checkKeyword(1, 0, "", CTOKEN_UP);
     }
-    break;
-    case 'D':{
-      if (scannerCurrent - scannerStart > 1) {
+    case 'D': {
+      if (compound) {
         switch (scannerStart[1]) {
-          case 'F': return CTOKEN_DOWNFORWARD;
-          case 'B': return CTOKEN_DOWNBACK;
+          case 'F': return checkKeyword(2, 0, "", CTOKEN_DOWNFORWARD);
+          case 'B': return checkKeyword(2, 0, "", CTOKEN_DOWNBACK);
         }
       }
-      return CTOKEN_DOWN;
+      return checkKeyword(1, 0, "", CTOKEN_DOWN);
     }
-    break;
-    case 'L': {
-      if (scannerCurrent - scannerStart > 1) {
+    case 'L': return checkKeyword(1, 1, "P", CTOKEN_LP) != CTOKEN_ERROR
+                   ? CTOKEN_LP : checkKeyword(1, 1, "K", CTOKEN_LK);
+    case 'H': return checkKeyword(1, 1, "P", CTOKEN_HP) != CTOKEN_ERROR
+                   ? CTOKEN_HP : checkKeyword(1, 1, "K", CTOKEN_HK);
+    case 'A': return checkKeyword(1, 1, "P", CTOKEN_AP) != CTOKEN_ERROR
+                   ? CTOKEN_AP : checkKeyword(1, 1, "K", CTOKEN_AK);
+    case 'M': {
+      if (compound) {
         switch (scannerStart[1]) {
-          case 'P': return CTOKEN_LP;
-          case 'K': return CTOKEN_LK;
+          case 'P': return checkKeyword(2, 0, "", CTOKEN_MP);
+          case 'K': return checkKeyword(2, 0, "", CTOKEN_MK);
+          case 'I': return checkKeyword(2, 3, "SC1", CTOKEN_MISC1) != CTOKEN_ERROR
+                        ? CTOKEN_MISC1 : checkKeyword(2, 3, "SC2", CTOKEN_MISC2);
         }
       }
+      break;
     }
-    break; 
-    case 'M': {
-      if (scannerCurrent - scannerStart > 1) {
+    case 'S': {
+      if (compound) {
         switch (scannerStart[1]) {
-          case 'P': return CTOKEN_MP;
-          case 'K': return CTOKEN_MK;
+          case 'T': return checkKeyword(2, 3, "ART", CTOKEN_START);
+          case 'E': return checkKeyword(2, 4, "LECT", CTOKEN_SELECT);
         }
       }
+      break;
     }
     default:
     break;
   }
-  return CTOKEN_END;
+  return CTOKEN_ERROR;
+}
+
+CommandTokenType CommandScanner::checkKeyword(int start, int length, const char *rest,
+                                              CommandTokenType type) {
+  if (scannerCurrent - scannerStart == start + length &&
+      std::memcmp(scannerStart + start, rest, length) == 0) {
+    return type;
+  }
+  return CTOKEN_ERROR;
+}
+
+int CommandScanner::tokenOffset(const CommandToken& token) const {
+  return (int)(token.start - sourceStart);
 }
 
 CommandToken CommandScanner::makeToken(CommandTokenType tokenType) {
@@ -128,16 +130,17 @@ CommandToken CommandScanner::makeToken(CommandTokenType tokenType) {
 }
 
 bool CommandScanner::isAtEnd() {
-  return *scannerCurrent == '\0';
+  return scannerCurrent >= scannerEnd || *scannerCurrent == '\0';
 }
 
 char CommandScanner::peek(){
+  if (isAtEnd()) return '\0';
   return *scannerCurrent;
 }
 
 char CommandScanner::peekNext(){
-  if (isAtEnd()) return '\0';
-  return *scannerCurrent+1;
+  if (scannerCurrent + 1 >= scannerEnd) return '\0';
+  return scannerCurrent[1];
 }
 
 char CommandScanner::advance(){
@@ -1,8 +1,7 @@
 #pragma once
 #include "stdint.h"
 #include <cstdlib>
-#include <map>
-#include <vector>
+#include <string_view>
 #include "Input.h"
 
 enum CommandTokenType {
@@ -19,6 +18,14 @@ enum CommandTokenType {
   CTOKEN_LK,
   CTOKEN_MP,
   CTOKEN_MK,
+  CTOKEN_HP,
+  CTOKEN_HK,
+  CTOKEN_AP,
+  CTOKEN_AK,
+  CTOKEN_START,
+  CTOKEN_SELECT,
+  CTOKEN_MISC1,
+  CTOKEN_MISC2,
   CTOKEN_NUMBER,
 
   CTOKEN_RELEASED,
@@ -30,15 +37,62 @@ enum CommandTokenType {
   CTOKEN_ANY,
   CTOKEN_NOT,
   CTOKEN_DELIM,
+  CTOKEN_CHORD_START,
+  CTOKEN_CHORD_END,
+  CTOKEN_EDGE,
+  CTOKEN_ERROR,
   CTOKEN_END,
 };
 
+// a view into the source string, tokens never own memory
 struct CommandToken {
   CommandTokenType type;
   const char *start;
   uint8_t length;
+
+  std::string_view lexeme() const { return { start, length }; }
 };
 
+inline const char* tokenTypeToString(CommandTokenType type) {
+  switch (type) {
+    case CTOKEN_NEUTRAL:     return "NEUTRAL";
+    case CTOKEN_FORWARD:     return "FORWARD";
+    case CTOKEN_BACK:        return "BACK";
+    case CTOKEN_UP:          return "UP";
+    case CTOKEN_DOWN:        return "DOWN";
+    case CTOKEN_UPFORWARD:   return "UPFORWARD";
+    case CTOKEN_UPBACK:      return "UPBACK";
+    case CTOKEN_DOWNFORWARD: return "DOWNFORWARD";
+    case CTOKEN_DOWNBACK:    return "DOWNBACK";
+    case CTOKEN_LP:          return "LP";
+    case CTOKEN_LK:          return "LK";
+    case CTOKEN_MP:          return "MP";
+    case CTOKEN_MK:          return "MK";
+    case CTOKEN_HP:          return "HP";
+    case CTOKEN_HK:          return "HK";
+    case CTOKEN_AP:          return "AP";
+    case CTOKEN_AK:          return "AK";
+    case CTOKEN_START:       return "START";
+    case CTOKEN_SELECT:      return "SELECT";
+    case CTOKEN_MISC1:       return "MISC1";
+    case CTOKEN_MISC2:       return "MISC2";
+    case CTOKEN_NUMBER:      return "NUMBER";
+    case CTOKEN_RELEASED:    return "RELEASED";
+    case CTOKEN_HELD:        return "HELD";
+    case CTOKEN_AND:         return "AND";
+    case CTOKEN_OR:          return "OR";
+    case CTOKEN_ANY:         return "ANY";
+    case CTOKEN_NOT:         return "NOT";
+    case CTOKEN_DELIM:       return "DELIM";
+    case CTOKEN_CHORD_START: return "CHORD_START";
+    case CTOKEN_CHORD_END:   return "CHORD_END";
+    case CTOKEN_EDGE:        return "EDGE";
+    case CTOKEN_ERROR:       return "ERROR";
+    case CTOKEN_END:         return "END";
+    default:                 return "UNKNOWN";
+  }
+}
+
 static uint32_t parseInputMask(const CommandToken* token) {
   switch (token->type) {
     case CTOKEN_NEUTRAL: return Input::NOINPUT;
@@ -54,21 +108,41 @@ static uint32_t parseInputMask(const CommandToken* token) {
     case CTOKEN_LK:      return Input::LIGHT_K;
     case CTOKEN_MP:      return Input::MEDIUM_P;
     case CTOKEN_MK:      return Input::MEDIUM_K;
+    case CTOKEN_HP:      return Input::HEAVY_P;
+    case CTOKEN_HK:      return Input::HEAVY_K;
+    case CTOKEN_AP:      return Input::ALL_P;
+    case CTOKEN_AK:      return Input::ALL_K;
+    case CTOKEN_START:   return Input::START;
+    case CTOKEN_SELECT:  return Input::SELECT;
+    case CTOKEN_MISC1:   return Input::MISC1;
+    case CTOKEN_MISC2:   return Input::MISC2;
     default:             return 0;
   }
 }
 
+inline bool isInputToken(CommandTokenType type) {
+  return type <= CTOKEN_MISC2;
+}
+
 // Parses a number token into a uint32_t delay (number of frames).
 static uint32_t parseNumber(const CommandToken* token) {
-  return static_cast<uint32_t>(std::strtol(token->start, nullptr, 10));
+  uint32_t value = 0;
+  for (uint8_t i = 0; i < token->length; i++) {
+    value = value * 10 + (token->start[i] - '0');
+  }
+  return value;
 }
 
+// Pull scanner: init() with a source string, then call scanToken() until CTOKEN_END.
+// Nothing is allocated, tokens point back into the source.
+// Unknown words and characters come back as CTOKEN_ERROR.
 class CommandScanner {
 public:
   CommandScanner();
   ~CommandScanner();
 
-  std::vector<CommandToken> scan(const char *inputString);
+  void init(std::string_view source);
+  CommandToken scanToken();
 
   CommandTokenType getInputType();
   CommandToken makeToken(CommandTokenType type);
@@ -80,35 +154,14 @@ public:
   void skipWhitespace();
   bool isAlpha(char c);
   bool isDigit(char c);
-  CommandTokenType checkKeyword(int start, int end, const char *rest,
+  CommandTokenType checkKeyword(int start, int length, const char *rest,
                                 CommandTokenType type);
-
-  std::map<CommandTokenType, const char *> tokenToString = {
-      {CTOKEN_NEUTRAL, "NEUTRAL"},
-      {CTOKEN_DOWN, "DOWN"},
-      {CTOKEN_FORWARD, "FORWARD"},
-      {CTOKEN_BACK, "BACK"},
-      {CTOKEN_UP, "UP"},
-      {CTOKEN_DOWNBACK, "DOWNBACK"},
-      {CTOKEN_DOWNFORWARD, "DOWNFORWARD"},
-      {CTOKEN_UPBACK, "UPBACK"},
-      {CTOKEN_UPFORWARD, "UPFORWARD"},
-      {CTOKEN_LP, "LP"},
-      {CTOKEN_LK, "LK"},
-      {CTOKEN_MP, "MP"},
-      {CTOKEN_MK, "MK"},
-      {CTOKEN_NUMBER, "NUMBER"},
-      {CTOKEN_RELEASED, "RELEASED"},
-      {CTOKEN_HELD, "HELD"},
-      {CTOKEN_AND, "AND"},
-      {CTOKEN_OR, "OR"},
-      {CTOKEN_ANY, "ANY"},
-      {CTOKEN_NOT, "NOT"},
-      {CTOKEN_DELIM, "DELIM"},
-      {CTOKEN_END, "END"},
-  };
+  // byte offset of a token from the start of the source passed to init()
+  int tokenOffset(const CommandToken& token) const;
 
 private:
-  const char *scannerStart;
-  const char *scannerCurrent;
+  const char *sourceStart = nullptr;
+  const char *scannerStart = nullptr;
+  const char *scannerCurrent = nullptr;
+  const char *scannerEnd = nullptr;
 };
@@ -0,0 +1,28 @@
+#include "CommandStats.h"
+
+void CommandStats::resize(int commandCount) {
+  if ((int)counters.size() < commandCount)
+    counters.resize(commandCount, CommandCounters{});
+}
+
+void CommandStats::merge(const CommandStats& other) {
+  resize((int)other.counters.size());
+
+  for (size_t i = 0; i < other.counters.size(); i++) {
+    CommandCounters& dst = counters[i];
+    const CommandCounters& src = other.counters[i];
+    dst.evaluations += src.evaluations;
+    dst.hits += src.hits;
+    dst.instructions += src.instructions;
+    dst.framesProbed += src.framesProbed;
+    for (int b = 0; b < LATENCY_BUCKETS; b++) {
+      dst.latency[b] += src.latency[b];
+    }
+  }
+}
+
+void CommandStats::clear() {
+  for (CommandCounters& c : counters) {
+    c = CommandCounters{};
+  }
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Per-command counters for VirtualController::checkCommand.
+// Attach one per controller, or one per thread shared by that thread's
+// controllers, then merge() them for export. Command indices are only
+// comparable between controllers using the same command file.
+
+constexpr int LATENCY_BUCKETS{ 32 }; // detection latency in frames, last bucket is LATENCY_BUCKETS-1 and up
+
+struct CommandCounters {
+  uint64_t evaluations;
+  uint64_t hits;
+  uint64_t instructions; // VM instructions executed
+  uint64_t framesProbed; // history frames looked at by findMatchingFrame
+  uint32_t latency[LATENCY_BUCKETS]; // hits by frames since the command's last input
+};
+
+class CommandStats {
+public:
+  void record(int command, bool hit, uint32_t instructions, uint32_t framesProbed, int latency) {
+    CommandCounters& c = counters[command];
+    c.evaluations++;
+    c.instructions += instructions;
+    c.framesProbed += framesProbed;
+    if (hit) {
+      c.hits++;
+      c.latency[latency < LATENCY_BUCKETS ? latency : LATENCY_BUCKETS - 1]++;
+    }
+  }
+
+  void resize(int commandCount);
+  void merge(const CommandStats& other);
+  void clear();
+
+  std::vector<CommandCounters> counters;
+};
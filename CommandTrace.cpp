@@ -0,0 +1,51 @@
+#include "CommandTrace.h"
+
+bool TraceRing::dump(FILE* file) const {
+  const uint32_t count = head < VC_TRACE_CAPACITY ? head : VC_TRACE_CAPACITY;
+  const TraceDumpHeader header{ TRACE_MAGIC, TRACE_VERSION, count, head - count };
+  if (fwrite(&header, sizeof(header), 1, file) != 1) return false;
+
+  for (uint32_t i = head - count; i != head; i++) {
+    if (fwrite(&events[i & (VC_TRACE_CAPACITY - 1)], sizeof(TraceEvent), 1, file) != 1) return false;
+  }
+  return true;
+}
+
+bool readTrace(FILE* file, std::vector<TraceEvent>& events, uint32_t* dropped) {
+  TraceDumpHeader header;
+  if (fread(&header, sizeof(header), 1, file) != 1) return false;
+  if (header.magic != TRACE_MAGIC || header.version != TRACE_VERSION) return false;
+
+  events.resize(header.count);
+  if (fread(events.data(), sizeof(TraceEvent), header.count, file) != header.count) return false;
+  if (dropped) *dropped = header.dropped;
+  return true;
+}
+
+void printTimeline(FILE* out, const std::vector<TraceEvent>& events) {
+  for (const TraceEvent& event : events) {
+    switch (event.type) {
+      case TRACE_UPDATE: {
+        fprintf(out, "frame %6u  update   input 0x%05x  pressed 0x%05x  released 0x%05x\n",
+                event.frame, event.arg1, event.arg2, traceReleased(event));
+        break;
+      }
+      case TRACE_COMMAND: {
+        if (event.frameOffset >= 0) {
+          fprintf(out, "frame %6u    cmd %-4u MATCH  at offset %-3d", event.frame, event.command, event.frameOffset);
+        } else {
+          fprintf(out, "frame %6u    cmd %-4u miss            ", event.frame, event.command);
+        }
+        fprintf(out, "  %u instructions, %u frames scanned\n", event.arg1, event.arg2);
+        break;
+      }
+      case TRACE_BAD_OPCODE:
+        fprintf(out, "frame %6u    cmd %-4u BAD OPCODE %u at instruction %u\n",
+                event.frame, event.command, event.arg1, event.arg2);
+        break;
+      default:
+        fprintf(out, "frame %6u  unknown event %u\n", event.frame, event.type);
+        break;
+    }
+  }
+}
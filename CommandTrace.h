@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Binary event ring for command evaluation.
+// Build with -DVC_TRACE to compile the hooks into VirtualController, the ring
+// still starts disabled. Nothing is formatted while recording, use
+// tools/TraceDecode.cpp on a dump to get a readable timeline.
+
+#ifndef VC_TRACE_CAPACITY
+#define VC_TRACE_CAPACITY 256 // events per controller, must be a power of two
+#endif
+
+static_assert((VC_TRACE_CAPACITY & (VC_TRACE_CAPACITY - 1)) == 0, "VC_TRACE_CAPACITY must be a power of two");
+
+enum TraceEventType : uint8_t {
+  TRACE_UPDATE,     // arg1 = cleaned input, arg2 = pressedBits, releasedBits packed, see traceUpdate
+  TRACE_COMMAND,    // arg1 = instructions executed, arg2 = history frames scanned
+  TRACE_BAD_OPCODE, // the VM hit an opcode it doesn't know, arg1 = opcode, arg2 = instruction index
+};
+
+struct TraceEvent {
+  uint32_t frame;       // controller update count
+  TraceEventType type;
+  int8_t frameOffset;   // TRACE_COMMAND: matched frame offset, -1 for no match
+  uint16_t command;     // TRACE_COMMAND: command index
+  uint32_t arg1;
+  uint32_t arg2;
+};
+
+static_assert(sizeof(TraceEvent) == 16, "TraceEvent is written to disk as-is");
+
+// An update has no command or offset, its releasedBits (17 bits, NOINPUT
+// included) ride in those two fields instead of growing every event.
+inline TraceEvent traceUpdate(uint32_t frame, uint32_t input, uint32_t pressedBits, uint32_t releasedBits) {
+  return { frame, TRACE_UPDATE, (int8_t)(releasedBits >> 16), (uint16_t)releasedBits, input, pressedBits };
+}
+
+inline uint32_t traceReleased(const TraceEvent& update) {
+  return (uint32_t)(uint8_t)update.frameOffset << 16 | update.command;
+}
+
+constexpr uint32_t TRACE_MAGIC{ 0x52544356 }; // "VCTR"
+constexpr uint32_t TRACE_VERSION{ 2 }; // 2: updates carry the real releasedBits
+
+struct TraceDumpHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t count;
+  uint32_t dropped; // events overwritten before the dump
+};
+
+class TraceRing {
+public:
+  void record(const TraceEvent& event) {
+    events[head++ & (VC_TRACE_CAPACITY - 1)] = event;
+  }
+
+  // writes a TraceDumpHeader followed by the events, oldest first
+  bool dump(FILE* file) const;
+
+  bool enabled = false;
+  uint32_t head = 0;
+  TraceEvent events[VC_TRACE_CAPACITY];
+};
+
+// offline side, used by the decoder tool
+bool readTrace(FILE* file, std::vector<TraceEvent>& events, uint32_t* dropped = nullptr);
+void printTimeline(FILE* out, const std::vector<TraceEvent>& events);
@@ -1,6 +1,5 @@
 #pragma once
 #include <cstdint>
-#include <vector>
 // each 'commandString' is a descriptor for a sequence of bytecode instructions.
 // P | ~P = ((wasPressed(LP)) || (wasReleased(LP)))
 // @F & !D = ((wasPressed(F, strict = false)) && !(wasPressed(D)))
@@ -27,10 +26,15 @@
 //  MP + back IS pressed 
 //  "MP & *B",
 //
-// input = N, F, B, U, D, UF, UB, DF, DB, LP, LK, MP, MK
+// input = N, F, B, U, D, UF, UB, DF, DB, LP, MP, HP, AP, LK, MK, HK, AK, START, SELECT, MISC1, MISC2
 // funcMods = ~, *, @
 // unary = !
 // binary = &, |
+// chord = [inputs], optionally prefixed by a frame window and '~', '^' or '!'
+//   "LP & LK"      LP and LK on the same frame
+//   "3[LP LK]"     LP and LK pressed within 3 frames of each other (default window is 3)
+//   "^[LP LK]"     negative edge, a release counts as a press
+//   "~D, DF, F, 2[MP MK]"
 // TODO: unary and binary
 //  "MP & *F",
 //  "MP & *B",
@@ -40,6 +44,11 @@
 //  "~D, DB, @B & !D, LP | ~LP",
 //  TODO: load from file
 //   "~D, 20DF, 20F, 8LP | 8~LP", // 214P
+
+// Bump whenever an opcode or operand encoding changes, anything holding compiled
+// bytecode (e.g. a CommandLibrary segment) checks it. 2 added OP_CHORD.
+constexpr uint32_t COMMAND_BYTECODE_VERSION{ 2 };
+
 // First, we define our simple bytecode instruction set.
 //
 enum CommandOp : uint8_t {
@@ -49,7 +58,8 @@ enum CommandOp : uint8_t {
   OP_DELAY,      // Enforce a timing constraint (e.g., "8" frames)
   OP_AND,        // Logical AND operator
   OP_OR,         // Logical OR operator
-  OP_END         // End of command marker
+  OP_END,        // End of command marker
+  OP_CHORD       // Every input in the operand within a window of frames ("3[LP LK]")
 };
 
 struct CommandIns {
@@ -57,14 +67,41 @@ struct CommandIns {
   uint32_t operand; // Represents an input bitmask or delay
 };
 
-// The compiled command, as a contiguous sequence of instructions.
+// The compiled command, a contiguous run of instructions inside a CommandArena.
+// Always terminated by OP_END.
 struct CommandCode {
-  std::vector<CommandIns> instructions;
+  uint32_t offset; // index of the first instruction in the arena
+  uint32_t length; // instruction count, including OP_END
   bool clears; // Indicates whether the command clears the input buffer upon execution.
 };
 
+// Flat instruction storage shared by every command in a set.
+// The memory belongs to whoever hands it to the compiler.
+struct CommandArena {
+  CommandIns* instructions = nullptr;
+  uint32_t capacity = 0;
+  uint32_t size = 0;
+};
+
+// A compiled command set that someone else owns, e.g. a shared CommandLibrary segment.
+struct CommandSetView {
+  const CommandCode* codes = nullptr;
+  const CommandIns* instructions = nullptr; // CommandCode offsets are relative to this
+  int count = 0;
+};
+
 // Modifier flag constants (pick bits that do not conflict with your input masks)
 constexpr uint32_t ANY_FLAG = 0x80000000; // set by '@'
 constexpr uint32_t NOT_FLAG = 0x40000000; // set by '!'
 constexpr uint32_t OP_MASK = 0x3FFFFFFF;
 
+// OP_CHORD operands also carry the window and which edges count
+constexpr uint32_t CHORD_INPUT_MASK = 0x0001FFFF;
+constexpr uint32_t CHORD_WINDOW_MASK = 0x07000000; // window - 1
+constexpr uint32_t CHORD_WINDOW_SHIFT = 24;
+constexpr uint32_t CHORD_RELEASE_FLAG = 0x08000000; // set by '~', released instead of pressed
+constexpr uint32_t CHORD_EDGE_FLAG = 0x10000000;    // set by '^', negative edge: pressed or released
+
+constexpr int CHORD_DEFAULT_WINDOW{ 3 };
+constexpr int CHORD_MAX_WINDOW{ 8 };
+
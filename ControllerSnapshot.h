@@ -0,0 +1,78 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include "Input.h"
+
+constexpr int SNAPSHOT_MAX_COMMANDS{ 256 }; // hits published, bigger sets get the rest of the snapshot only
+constexpr int SNAPSHOT_HIT_WORDS{ SNAPSHOT_MAX_COMMANDS / 64 };
+
+// What other threads get to see of a controller, published once per frame.
+struct ControllerSnapshot {
+  uint64_t commandHits[SNAPSHOT_HIT_WORDS]; // bit i set if command i matched since the last update
+  uint32_t commandCount; // the controller's, hits past SNAPSHOT_MAX_COMMANDS aren't in commandHits
+  uint32_t frame;        // publish count
+  uint32_t currentState;
+  uint32_t prevState;
+  uint32_t historyNext;  // the history's next write slot when published
+  InputFrame latest;     // the history's front()
+
+  bool hit(int command) const {
+    return command >= 0 && command < SNAPSHOT_MAX_COMMANDS
+      && (commandHits[command >> 6] >> (command & 63)) & 1;
+  }
+};
+
+static_assert(sizeof(ControllerSnapshot) % sizeof(uint32_t) == 0, "published word by word");
+
+// Single writer, any number of readers, nobody takes a lock.
+// The writer bumps the sequence to odd, stores the words and bumps it back to
+// even; a reader retries if it saw an odd sequence or it changed underneath it.
+class SnapshotSeqlock {
+public:
+  SnapshotSeqlock() = default;
+  // copies aren't published to anyone yet, so a plain load/store is enough
+  SnapshotSeqlock(const SnapshotSeqlock& other) { store(other.load()); }
+  SnapshotSeqlock& operator=(const SnapshotSeqlock& other) {
+    store(other.load());
+    return *this;
+  }
+
+  void store(const ControllerSnapshot& snapshot) {
+    uint32_t words[WORDS];
+    std::memcpy(words, &snapshot, sizeof(snapshot));
+
+    const uint32_t seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (int i = 0; i < WORDS; i++) {
+      data[i].store(words[i], std::memory_order_relaxed);
+    }
+    sequence.store(seq + 2, std::memory_order_release);
+  }
+
+  ControllerSnapshot load() const {
+    uint32_t words[WORDS];
+    for (;;) {
+      const uint32_t before = sequence.load(std::memory_order_acquire);
+      if (before & 1) continue;
+
+      for (int i = 0; i < WORDS; i++) {
+        words[i] = data[i].load(std::memory_order_relaxed);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (sequence.load(std::memory_order_relaxed) == before) break;
+    }
+
+    ControllerSnapshot snapshot;
+    std::memcpy(&snapshot, words, sizeof(snapshot));
+    return snapshot;
+  }
+
+private:
+  static constexpr int WORDS = sizeof(ControllerSnapshot) / sizeof(uint32_t);
+
+  // own cache line, readers spinning here shouldn't touch the controller's hot state
+  alignas(64) std::atomic<uint32_t> sequence{ 0 };
+  std::atomic<uint32_t> data[WORDS]{};
+};
@@ -0,0 +1,32 @@
+#include "EventHistory.h"
+
+EventHistory::EventHistory(){
+  for (auto i = 0; i < MAX_EVENTS; i++) {
+    events[i] = InputEvent{};
+  }
+}
+
+void EventHistory::push(const InputFrame& elem){
+  frame++;
+  if ((elem.pressedBits | elem.releasedBits) == 0) return;
+
+  events[next] = { frame, elem.pressedBits, elem.releasedBits };
+  next = (next + 1) & (MAX_EVENTS - 1);
+  if (count < MAX_EVENTS) count++;
+}
+
+InputFrame EventHistory::front() const {
+  return (*this)[0];
+}
+
+InputFrame EventHistory::operator[](int index) const {
+  if (index < 0 || index >= MAX_HISTORY) return InputFrame{};
+
+  for (int i = 0; i < count; i++) {
+    const InputEvent& event = events[(next - 1 - i) & (MAX_EVENTS - 1)];
+    const int offset = (int)(frame - event.frame);
+    if (offset == index) return InputFrame{ event.pressedBits, event.releasedBits, 0 };
+    if (offset > index) break;
+  }
+  return InputFrame{};
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include "Input.h"
+
+// Event-sourced alternative to CircularBuffer: only frames where something was
+// pressed or released are stored, tagged with their frame number. Empty frames
+// cost nothing, so snapshots and scans scale with the number of transitions.
+//
+// operator[] answers like CircularBuffer's for any offset below MAX_HISTORY as
+// long as the ring hasn't dropped the event. An event is only dropped after
+// MAX_EVENTS newer ones, i.e. at least MAX_EVENTS frames back, and command
+// scans never look further back than that, so command results are identical.
+
+constexpr int MAX_EVENTS{ 32 }; // must be a power of two
+
+struct InputEvent {
+  uint32_t frame;
+  uint32_t pressedBits;
+  uint32_t releasedBits;
+};
+
+class EventHistory {
+public:
+  EventHistory();
+
+  void push(const InputFrame& elem);
+  InputFrame front() const;
+  InputFrame operator[](int index) const;
+
+  // First offset in [startOffset, buffLen) whose frame satisfies match, or -1.
+  // Visits events instead of frames; empty frames are only tested once.
+  template <typename Match>
+  int find(Match&& match, int startOffset, int buffLen, uint32_t* probed = nullptr) const {
+    if (buffLen > MAX_HISTORY) buffLen = MAX_HISTORY;
+    const bool emptyMatches = match(InputFrame{});
+    int expected = startOffset; // the next offset nobody has looked at
+
+    for (int i = 0; i < count; i++) {
+      const InputEvent& event = events[(next - 1 - i) & (MAX_EVENTS - 1)];
+      const int offset = (int)(frame - event.frame);
+      if (offset < startOffset) continue;
+      if (offset >= buffLen) break;
+      if (probed) (*probed)++;
+
+      // an empty frame sits between the last event we looked at and this one
+      if (emptyMatches && offset > expected) return expected;
+      if (match(InputFrame{ event.pressedBits, event.releasedBits, 0 })) return offset;
+      expected = offset + 1;
+    }
+    if (emptyMatches && expected < buffLen) return expected;
+    return -1;
+  }
+
+  uint32_t frame = 0; // number of the newest frame, the one at offset 0
+  int next = 0;       // next slot in events
+  int count = 0;      // events held, up to MAX_EVENTS
+  InputEvent events[MAX_EVENTS];
+};
@@ -0,0 +1,91 @@
+#include "RosterLoader.h"
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+
+RosterLoader::RosterLoader(const char* directory, RosterMode mode, int threads) {
+  namespace fs = std::filesystem;
+  if (!fs::is_directory(directory))
+    throw std::runtime_error("Roster directory not found: " + std::string(directory));
+
+  for (const fs::directory_entry& entry : fs::directory_iterator(directory)) {
+    if (!entry.is_regular_file() || entry.path().extension() != ".json") continue;
+
+    auto character = std::make_unique<Character>();
+    character->name = entry.path().stem().string();
+    character->path = entry.path().string();
+    character->future = character->promise.get_future().share();
+    byName[character->name] = character.get();
+    roster.push_back(std::move(character));
+  }
+
+  if (threads <= 0) threads = std::max(1u, std::thread::hardware_concurrency());
+  // no point in more workers than files
+  threads = std::min<int>(threads, std::max<size_t>(roster.size(), 1));
+  for (int i = 0; i < threads; i++) {
+    workers.emplace_back(&RosterLoader::work, this);
+  }
+
+  if (mode == ROSTER_EAGER) {
+    for (auto& character : roster) enqueue(*character);
+  }
+}
+
+RosterLoader::~RosterLoader() {
+  {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    stopping = true;
+  }
+  queueReady.notify_all();
+  for (std::thread& worker : workers) worker.join();
+}
+
+std::shared_future<CommandSetView> RosterLoader::request(const std::string& name) {
+  auto found = byName.find(name);
+  if (found == byName.end())
+    throw std::runtime_error("Character not in roster: " + name);
+
+  enqueue(*found->second);
+  return found->second->future;
+}
+
+CommandSetView RosterLoader::get(const std::string& name) {
+  return request(name).get();
+}
+
+std::vector<std::string> RosterLoader::characters() const {
+  std::vector<std::string> names;
+  for (const auto& character : roster) names.push_back(character->name);
+  return names;
+}
+
+void RosterLoader::enqueue(Character& character) {
+  std::call_once(character.queued, [&] {
+    {
+      std::lock_guard<std::mutex> lock(queueMutex);
+      queue.push_back(&character);
+    }
+    queueReady.notify_one();
+  });
+}
+
+void RosterLoader::work() {
+  for (;;) {
+    Character* character;
+    {
+      std::unique_lock<std::mutex> lock(queueMutex);
+      queueReady.wait(lock, [&] { return stopping || !queue.empty(); });
+      // anything still queued at shutdown gets a broken promise
+      if (stopping) return;
+      character = queue.front();
+      queue.pop_front();
+    }
+
+    try {
+      character->compiler.init(character->path.c_str(), COMPILE_VALIDATE);
+      character->promise.set_value(character->compiler.view());
+    } catch (...) {
+      character->promise.set_exception(std::current_exception());
+    }
+  }
+}
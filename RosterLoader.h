@@ -0,0 +1,59 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "CommandCompiler.h"
+
+enum RosterMode : uint8_t {
+  ROSTER_EAGER, // every character starts compiling as soon as the loader exists
+  ROSTER_LAZY,  // a character compiles the first time someone asks for it
+};
+
+// Loads a directory of character definitions (<name>.json, one per character)
+// on a small thread pool. The constructor only lists the directory, so it
+// returns right away; ask for a character to get a future for its commands and
+// build controllers with VirtualController(loader.get("ryu")).
+// The loader owns the compiled sets and has to outlive those controllers.
+class RosterLoader {
+public:
+  explicit RosterLoader(const char* directory, RosterMode mode = ROSTER_EAGER, int threads = 0);
+  RosterLoader(const RosterLoader&) = delete;
+  RosterLoader& operator=(const RosterLoader&) = delete;
+  ~RosterLoader();
+
+  // Queues the character if it isn't already. A bad file surfaces as the
+  // future's exception. Throws if the name isn't in the directory.
+  std::shared_future<CommandSetView> request(const std::string& name);
+  // request() and wait
+  CommandSetView get(const std::string& name);
+
+  std::vector<std::string> characters() const;
+
+private:
+  struct Character {
+    std::string name;
+    std::string path;
+    CommandCompiler compiler;
+    std::once_flag queued;
+    std::promise<CommandSetView> promise;
+    std::shared_future<CommandSetView> future;
+  };
+
+  void enqueue(Character& character);
+  void work();
+
+  std::vector<std::unique_ptr<Character>> roster;
+  std::unordered_map<std::string, Character*> byName;
+
+  std::vector<std::thread> workers;
+  std::deque<Character*> queue;
+  std::mutex queueMutex;
+  std::condition_variable queueReady;
+  bool stopping = false;
+};
@@ -0,0 +1,174 @@
+// Generated by tools/CommandCodegen.cpp from commands.json, do not edit.
+// Build with the same VC_EVENT_HISTORY setting as VirtualController.cpp, it won't link otherwise.
+#include "CommandMatch.h"
+
+// 0 tester: DF
+static bool match0(MatchContext& ctx) {
+  int f = 0;
+  const int m1 = matchFind(ctx, 0x9u, true, true, f);
+  const bool t0 = m1 >= 0;
+  f = t0 ? m1 : f;
+  if (!t0) { ctx.ip = 1; ctx.frameOffset = f; return false; }
+  ctx.latency = f;
+  ctx.ip = 1;
+  ctx.frameOffset = f;
+  return true;
+}
+
+// 1 623L: @F, D, DF, LK | ~LK
+static bool match1(MatchContext& ctx) {
+  int f = 0;
+  const int m2 = matchFind(ctx, 0x100u, true, false, f);
+  const bool t1 = m2 >= 0;
+  f = t1 ? m2 : f;
+  const int m4 = matchFind(ctx, 0x100u, true, true, f);
+  const bool t3 = m4 >= 0;
+  f = t3 ? m4 : f;
+  const bool t0 = t1 | t3;
+  if (!t0) { ctx.ip = 3; ctx.frameOffset = f; return false; }
+  ctx.latency = f;
+  const int m6 = matchFind(ctx, 0x9u, true, true, f);
+  const bool t5 = m6 >= 0;
+  f = t5 ? m6 : f;
+  if (!t5) { ctx.ip = 4; ctx.frameOffset = f; return false; }
+  const int m8 = matchFind(ctx, 0x8u, true, true, f);
+  const bool t7 = m8 >= 0;
+  f = t7 ? m8 : f;
+  if (!t7) { ctx.ip = 5; ctx.frameOffset = f; return false; }
+  const int m10 = matchFind(ctx, 0x1u, false, true, f);
+  const bool t9 = m10 >= 0;
+  f = t9 ? m10 : f;
+  if (!t9) { ctx.ip = 6; ctx.frameOffset = f; return false; }
+  ctx.ip = 6;
+  ctx.frameOffset = f;
+  return true;
+}
+
+// 2 236L: ~D, DF, F, LK | ~LK
+static bool match2(MatchContext& ctx) {
+  int f = 0;
+  const int m2 = matchFind(ctx, 0x100u, true, false, f);
+  const bool t1 = m2 >= 0;
+  f = t1 ? m2 : f;
+  const int m4 = matchFind(ctx, 0x100u, true, true, f);
+  const bool t3 = m4 >= 0;
+  f = t3 ? m4 : f;
+  const bool t0 = t1 | t3;
+  if (!t0) { ctx.ip = 3; ctx.frameOffset = f; return false; }
+  ctx.latency = f;
+  const int m6 = matchFind(ctx, 0x1u, true, true, f);
+  const bool t5 = m6 >= 0;
+  f = t5 ? m6 : f;
+  if (!t5) { ctx.ip = 4; ctx.frameOffset = f; return false; }
+  const int m8 = matchFind(ctx, 0x9u, true, true, f);
+  const bool t7 = m8 >= 0;
+  f = t7 ? m8 : f;
+  if (!t7) { ctx.ip = 5; ctx.frameOffset = f; return false; }
+  const int m10 = matchFind(ctx, 0x8u, true, false, f);
+  const bool t9 = m10 >= 0;
+  f = t9 ? m10 : f;
+  if (!t9) { ctx.ip = 6; ctx.frameOffset = f; return false; }
+  ctx.ip = 6;
+  ctx.frameOffset = f;
+  return true;
+}
+
+// 3 214L: ~D, DB, B, LP
+static bool match3(MatchContext& ctx) {
+  int f = 0;
+  const int m1 = matchFind(ctx, 0x10u, true, true, f);
+  const bool t0 = m1 >= 0;
+  f = t0 ? m1 : f;
+  if (!t0) { ctx.ip = 1; ctx.frameOffset = f; return false; }
+  ctx.latency = f;
+  const int m3 = matchFind(ctx, 0x2u, true, true, f);
+  const bool t2 = m3 >= 0;
+  f = t2 ? m3 : f;
+  if (!t2) { ctx.ip = 2; ctx.frameOffset = f; return false; }
+  const int m5 = matchFind(ctx, 0xAu, true, true, f);
+  const bool t4 = m5 >= 0;
+  f = t4 ? m5 : f;
+  if (!t4) { ctx.ip = 3; ctx.frameOffset = f; return false; }
+  const int m7 = matchFind(ctx, 0x8u, true, false, f);
+  const bool t6 = m7 >= 0;
+  f = t6 ? m7 : f;
+  if (!t6) { ctx.ip = 4; ctx.frameOffset = f; return false; }
+  ctx.ip = 4;
+  ctx.frameOffset = f;
+  return true;
+}
+
+// 4 dash: F, N, F
+static bool match4(MatchContext& ctx) {
+  int f = 0;
+  const int m1 = matchFind(ctx, 0x1u, true, true, f);
+  const bool t0 = m1 >= 0;
+  f = t0 ? m1 : f;
+  if (!t0) { ctx.ip = 1; ctx.frameOffset = f; return false; }
+  ctx.latency = f;
+  const int m3 = matchFind(ctx, 0x10000u, true, true, f);
+  const bool t2 = m3 >= 0;
+  f = t2 ? m3 : f;
+  if (!t2) { ctx.ip = 2; ctx.frameOffset = f; return false; }
+  const int m5 = matchFind(ctx, 0x1u, true, true, f);
+  const bool t4 = m5 >= 0;
+  f = t4 ? m5 : f;
+  if (!t4) { ctx.ip = 3; ctx.frameOffset = f; return false; }
+  ctx.ip = 3;
+  ctx.frameOffset = f;
+  return true;
+}
+
+static const CommandMatcher matchers[] = {
+  match0,
+  match1,
+  match2,
+  match3,
+  match4,
+};
+
+static const CommandIns instructions[] = {
+  { OP_PRESS, 0x9u },
+  { OP_END, 0x0u },
+  { OP_OR, 0x0u },
+  { OP_RELEASE, 0x100u },
+  { OP_PRESS, 0x100u },
+  { OP_PRESS, 0x9u },
+  { OP_PRESS, 0x8u },
+  { OP_PRESS, 0x80000001u },
+  { OP_END, 0x0u },
+  { OP_OR, 0x0u },
+  { OP_RELEASE, 0x100u },
+  { OP_PRESS, 0x100u },
+  { OP_PRESS, 0x1u },
+  { OP_PRESS, 0x9u },
+  { OP_RELEASE, 0x8u },
+  { OP_END, 0x0u },
+  { OP_PRESS, 0x10u },
+  { OP_PRESS, 0x2u },
+  { OP_PRESS, 0xAu },
+  { OP_RELEASE, 0x8u },
+  { OP_END, 0x0u },
+  { OP_PRESS, 0x1u },
+  { OP_PRESS, 0x10000u },
+  { OP_PRESS, 0x1u },
+  { OP_END, 0x0u },
+};
+
+static const CommandCode codes[] = {
+  { 0, 2, true },
+  { 2, 7, true },
+  { 9, 7, true },
+  { 16, 5, true },
+  { 21, 4, false },
+};
+
+inline namespace MATCH_HISTORY_NAMESPACE {
+
+extern const GeneratedCommandSet shippedCommands = {
+  matchers,
+  { codes, instructions, 5 },
+  "commands.json",
+};
+
+} // namespace MATCH_HISTORY_NAMESPACE
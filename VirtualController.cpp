@@ -1,13 +1,27 @@
 #include "VirtualController.h"
 #include "CommandVm.h"
+#include <cassert>
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
+#include <stdexcept>
 #include <string>
 #include <sys/types.h>
 
-VirtualController::VirtualController(){
-  commandCompiler.init("./char_def/commands.json");
+VirtualController::VirtualController() : VirtualController("./char_def/commands.json") {};
+
+VirtualController::VirtualController(const char* commandsPath, CompileMode mode){
+  commandCompiler.init(commandsPath, mode);
+};
+
+VirtualController::VirtualController(const CommandSetView& commands){
+  commandCompiler.attach(commands);
+};
+
+VirtualController::VirtualController(const GeneratedCommandSet& commands){
+  // the bytecode still answers commandCount / getCommand and keeps indices lined up
+  commandCompiler.attach(commands.bytecode);
+  matchers = commands.matchers;
 };
 
 VirtualController::~VirtualController(){};
@@ -16,35 +30,102 @@ void VirtualController::update(uint32_t input){
   prevState = currentState;
   currentState = cleanSOCD(input);
 
-  const uint32_t prevButtons = prevState & Input::BTN_MASK;
-  const uint32_t currButtons = currentState & Input::BTN_MASK;
-  const uint32_t changedButtons = prevButtons ^ currButtons;
+  const InputFrame currentFrame = makeFrame(prevState, currentState);
+  inputBuffer.push(currentFrame);
+  pushWindows(currentFrame);
+  std::memset(commandHits, 0, sizeof (commandHits));
 
-  const uint32_t prevStick = prevState & Input::DIR_MASK;
-  const uint32_t currStick = currentState & Input::DIR_MASK;
+#ifdef VC_TRACE
+  traceFrame++;
+  if (trace.enabled)
+    trace.record(traceUpdate(traceFrame, currentState, currentFrame.pressedBits, currentFrame.releasedBits));
+#endif
+}
 
-  InputFrame currentFrame;
-  currentFrame.pressedBits = changedButtons & currButtons;
-  currentFrame.releasedBits = changedButtons & prevButtons;
+void VirtualController::updateRange(const uint32_t* inputs, int count, CommandQuery* queries, int queryCount){
+  int frame = 0;
+  int q = 0;
 
-  if (prevStick != currStick) {
-    currentFrame.pressedBits  |= currStick == 0 ? Input::NOINPUT : currStick;
-    currentFrame.releasedBits |= prevStick == 0 ? Input::NOINPUT : prevStick;
+  for (int i = 0; i < queryCount; i++) {
+    // anything not answered below (frame out of range, out of order) reads as no match
+    queries[i].result = false;
+    assert(i == 0 || queries[i - 1].frame <= queries[i].frame);
   }
 
-  inputBuffer.push(currentFrame);
+  while (frame < count) {
+    // write everything up to the next queried frame in one go
+    const int stop = (q < queryCount && queries[q].frame >= frame && queries[q].frame < count)
+      ? queries[q].frame + 1 : count;
+    writeFrames(inputs + frame, stop - frame);
+    frame = stop;
+
+    while (q < queryCount && queries[q].frame < frame) {
+      CommandQuery& query = queries[q++];
+      // out of order queries can't be answered without replaying again
+      query.result = query.frame == frame - 1 && checkCommand(query.command, query.faceRight);
+    }
+  }
 }
 
-bool VirtualController::isPressed(uint32_t input, bool strict) {
-  return strict ? strictMatch(currentState, input) : (currentState & input) != 0;
+void VirtualController::writeFrames(const uint32_t* inputs, int count){
+#ifndef VC_EVENT_HISTORY
+  InputFrame* history = inputBuffer.buffer;
+  int next = inputBuffer.next;
+#endif
+  uint32_t prev = prevState;
+  uint32_t curr = currentState;
+  // like update(), only hits on the newest frame written survive
+  if (count > 0) std::memset(commandHits, 0, sizeof (commandHits));
+
+  for (int i = 0; i < count; i++) {
+    prev = curr;
+    curr = cleanSOCD(inputs[i]);
+    const InputFrame frame = makeFrame(prev, curr);
+    pushWindows(frame);
+#ifdef VC_EVENT_HISTORY
+    inputBuffer.push(frame);
+#else
+    history[next] = frame;
+    next = (next + 1 == MAX_HISTORY) ? 0 : next + 1;
+#endif
+
+#ifdef VC_TRACE
+    traceFrame++;
+    if (trace.enabled)
+      trace.record(traceUpdate(traceFrame, curr, frame.pressedBits, frame.releasedBits));
+#endif
+  }
+
+#ifndef VC_EVENT_HISTORY
+  inputBuffer.next = next;
+#endif
+  prevState = prev;
+  currentState = curr;
+}
+
+InputFrame VirtualController::makeFrame(uint32_t prev, uint32_t curr){
+  const uint32_t prevButtons = prev & Input::BTN_MASK;
+  const uint32_t currButtons = curr & Input::BTN_MASK;
+  const uint32_t changedButtons = prevButtons ^ currButtons;
+
+  const uint32_t prevStick = prev & Input::DIR_MASK;
+  const uint32_t currStick = curr & Input::DIR_MASK;
+
+  InputFrame frame{};
+  frame.pressedBits = changedButtons & currButtons;
+  frame.releasedBits = changedButtons & prevButtons;
+
+  if (prevStick != currStick) {
+    frame.pressedBits  |= currStick == 0 ? Input::NOINPUT : currStick;
+    frame.releasedBits |= prevStick == 0 ? Input::NOINPUT : prevStick;
+  }
+  return frame;
 }
 
 bool VirtualController::wasPressed(uint32_t input, bool strict, bool pressed, int offset) {
   if (offset >= MAX_HISTORY || offset < 0) return false;
 
-  const InputFrame& currentFrame = inputBuffer[offset];
-  const uint32_t targetMask = pressed ? currentFrame.pressedBits : currentFrame.releasedBits;
-  return strict ? strictMatch(targetMask, input) : (targetMask & input) != 0;
+  return matchFrame(inputBuffer[offset], input, strict, pressed);
 }
 
 bool VirtualController::wasPressedBuffer(uint32_t input, bool strict, bool pressed, int buffLen){
@@ -54,8 +135,8 @@ bool VirtualController::wasPressedBuffer(uint32_t input, bool strict, bool press
   return false;
 }
 
-bool VirtualController::evalPrefix(const std::vector<CommandIns>& code, int &ip, int &frameOffset){
-  const CommandIns& ins = code[ip++];
+bool VirtualController::evalPrefix(const CommandIns* code, MatchContext& ctx){
+  const CommandIns& ins = code[ctx.ip++];
   uint32_t operand = ins.operand & OP_MASK;
 
   bool negated = (ins.operand & NOT_FLAG) != 0;
@@ -64,57 +145,128 @@ bool VirtualController::evalPrefix(const std::vector<CommandIns>& code, int &ip,
   bool val = false;
   switch (ins.opcode) {
     case OP_PRESS: {
-      int matchedFrame = findMatchingFrame(operand, !any, true, frameOffset);
+      int matchedFrame = matchFind(ctx, operand, !any, true, ctx.frameOffset);
       val = (matchedFrame >= 0);
-      if (val) frameOffset = matchedFrame;
+      if (val) ctx.frameOffset = matchedFrame;
       break;
     }
     case OP_RELEASE: {
-      int matchedFrame = findMatchingFrame(operand, !any, false, frameOffset);
+      int matchedFrame = matchFind(ctx, operand, !any, false, ctx.frameOffset);
       val = (matchedFrame >= 0);
-      if (val) frameOffset = matchedFrame;
+      if (val) ctx.frameOffset = matchedFrame;
       break;
     }
     case OP_HOLD: {
-      val = isPressed(operand, !any);
+      val = matchHeld(ctx.currentState, operand, !any);
+      break;
+    }
+    case OP_CHORD: {
+      int matchedFrame = matchChord(ctx, operand, ctx.frameOffset);
+      val = (matchedFrame >= 0);
+      if (val) ctx.frameOffset = matchedFrame;
       break;
     }
     case OP_AND: {
-      bool left = evalPrefix(code, ip, frameOffset);
-      if (!left) return false;
-      bool right = evalPrefix(code, ip, frameOffset);
+      bool left = evalPrefix(code, ctx);
+      if (!left) {
+        // step over the right operand, or whatever encloses this reads it as its own
+        skipPrefix(code, ctx);
+        val = false;
+        break;
+      }
+      bool right = evalPrefix(code, ctx);
       val = left && right;
       break;
     }
     case OP_OR: {
-      bool left  = evalPrefix(code, ip, frameOffset);
-      bool right = evalPrefix(code, ip, frameOffset);
+      bool left  = evalPrefix(code, ctx);
+      bool right = evalPrefix(code, ctx);
       val = left || right;
       break;
     }
 
     default:
       val = false;  // unknown opcode
-      printf("wtF?\n");
+#ifdef VC_TRACE
+      if (trace.enabled)
+        trace.record({ traceFrame, TRACE_BAD_OPCODE, 0, traceCommand, ins.opcode, (uint32_t)ctx.ip - 1 });
+#endif
       break;
   }
   return negated ? !val : val;
 }
 
+void VirtualController::skipPrefix(const CommandIns* code, MatchContext& ctx){
+  // a prefix subtree is done once every operator has had both operands
+  int pending = 1;
+  while (pending > 0) {
+    const CommandOp op = code[ctx.ip++].opcode;
+    ctx.skipped++;
+    pending += (op == OP_AND || op == OP_OR) ? 1 : -1;
+  }
+}
+
+void VirtualController::pushWindows(const InputFrame& frame){
+  for (int k = CHORD_MAX_WINDOW - 1; k > 0; k--) {
+    pressedWindow[k] = pressedWindow[k - 1] | frame.pressedBits;
+    releasedWindow[k] = releasedWindow[k - 1] | frame.releasedBits;
+  }
+  pressedWindow[0] = frame.pressedBits;
+  releasedWindow[0] = frame.releasedBits;
+}
+
+void VirtualController::rebuildWindows(){
+  for (int k = 0; k < CHORD_MAX_WINDOW; k++) {
+    pressedWindow[k] = 0;
+    releasedWindow[k] = 0;
+  }
+  // oldest first, same as update() would have seen them
+  for (int i = CHORD_MAX_WINDOW - 1; i >= 0; i--) {
+    pushWindows(inputBuffer[i]);
+  }
+}
+
 bool VirtualController::checkCommand(int index, bool faceRight) {
-  const auto &code = commandCompiler.getCommand(index)->instructions;
-  int frameOffset = 0;
-  int ip = 0;
-
-  // Evaluate *each* top‑level clause (comma‑separated) in turn
-  // until we hit an implicit OP_END or run out of code.
-  while (ip < (int)code.size() && code[ip].opcode != OP_END) {
-    // remember: Frameoffset is being modified by evalprefix
-    bool clause = evalPrefix(code, ip, frameOffset);
-    if (!clause) 
-    return false;
+  const CommandCode* command = commandCompiler.getCommand(index);
+  MatchContext ctx{ inputBuffer, currentState, pressedWindow, releasedWindow };
+#ifdef VC_TRACE
+  traceCommand = (uint16_t)index;
+#endif
+  bool matched = true;
+
+  if (matchers) {
+    matched = matchers[index](ctx);
+  } else {
+    const CommandIns* code = commandCompiler.getInstructions(command);
+    // Evaluate *each* top‑level clause (comma‑separated) in turn
+    // until we hit the OP_END every command is terminated with.
+    while (code[ctx.ip].opcode != OP_END) {
+      // remember: frameOffset is being modified by evalprefix
+      bool clause = evalPrefix(code, ctx);
+      if (!clause) {
+        matched = false;
+        break;
+      }
+      // clauses run newest first, so the first one found is the command's last input
+      if (ctx.latency < 0) ctx.latency = ctx.frameOffset;
+    }
   }
-  return true;
+
+  if (matched && index < SNAPSHOT_MAX_COMMANDS) commandHits[index >> 6] |= uint64_t(1) << (index & 63);
+  // instructions that actually ran, short-circuits excluded
+  const uint32_t executed = ctx.ip - ctx.skipped;
+  if (stats) stats->record(index, matched, executed, ctx.framesProbed, ctx.latency);
+
+#ifdef VC_TRACE
+  if (trace.enabled)
+    trace.record({ traceFrame, TRACE_COMMAND, (int8_t)(matched ? ctx.frameOffset : -1), (uint16_t)index,
+                   executed, ctx.framesProbed });
+#endif
+  return matched;
+}
+
+int VirtualController::commandCount() const {
+  return commandCompiler.commandCount();
 }
 
 VCState VirtualController::save(){
@@ -122,8 +274,12 @@ VCState VirtualController::save(){
 
   state.currentState = currentState;
   state.prevState = prevState;
+#ifdef VC_EVENT_HISTORY
+  state.inputHistory = inputBuffer;
+#else
   state.inputBuffNext = inputBuffer.next;
   std::memcpy(state.inputBuff, inputBuffer.buffer, sizeof (state.inputBuff));
+#endif
   
   return state;
 }
@@ -132,11 +288,49 @@ void VirtualController::load(VCState const& state){
 
   currentState = state.currentState;
   prevState = state.prevState;
+#ifdef VC_EVENT_HISTORY
+  inputBuffer = state.inputHistory;
+#else
   inputBuffer.next = state.inputBuffNext;
 
   std::memcpy(inputBuffer.buffer, state.inputBuff, sizeof (inputBuffer.buffer));
+#endif
+  rebuildWindows();
+  // hits belong to the frame we rolled back from
+  std::memset(commandHits, 0, sizeof (commandHits));
+}
+
+void VirtualController::publish(){
+  ControllerSnapshot current{};
+  std::memcpy(current.commandHits, commandHits, sizeof (commandHits));
+  current.commandCount = (uint32_t)commandCompiler.commandCount();
+  current.frame = ++publishCount;
+  current.currentState = currentState;
+  current.prevState = prevState;
+  current.historyNext = inputBuffer.next;
+  current.latest = inputBuffer.front();
+  snapshot.store(current);
 }
 
+ControllerSnapshot VirtualController::readSnapshot() const {
+  return snapshot.load();
+}
+
+void VirtualController::setStats(CommandStats* stats){
+  this->stats = stats;
+  if (stats) stats->resize(commandCompiler.commandCount());
+}
+
+#ifdef VC_TRACE
+void VirtualController::setTracing(bool enabled){
+  trace.enabled = enabled;
+}
+
+const TraceRing& VirtualController::getTrace() const {
+  return trace;
+}
+#endif
+
 std::string VirtualController::printHistory(){
   std::string retString;
   for (int i = 0; i < 8; i++) {
@@ -156,24 +350,3 @@ uint32_t VirtualController::cleanSOCD(uint32_t input){
 
   return input;
 }
-
-bool VirtualController::strictMatch(uint32_t bitsToCheck, uint32_t query) {
-  // Extract the directional and button parts from the query.
-  const uint32_t queryDir = query & Input::DIR_MASK;
-  const uint32_t queryBtn = query & Input::BTN_MASK;
-
-  // Check directional bits if any were provided.
-  bool dirMatch = (queryDir == 0) || ((bitsToCheck & Input::DIR_MASK) == queryDir);
-  // Check button bits if any were provided.
-  bool btnMatch = (queryBtn == 0) || ((bitsToCheck & Input::BTN_MASK) == queryBtn);
-
-  return dirMatch && btnMatch;
-}
-
-int VirtualController::findMatchingFrame(uint32_t operand, bool strict, bool pressed, int startOffset, int buffLen){
-  for (int i = startOffset; i < buffLen; ++i) {
-    if (wasPressed(operand, strict, pressed, i)) 
-      return i;
-  }
-  return -1;
-}
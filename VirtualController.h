@@ -1,18 +1,42 @@
 #pragma once
 #include <cstdint>
 #include "CommandCompiler.h"
+#include "CommandMatch.h"
 #include "CircularBuffer.h"
+#include "CommandStats.h"
+#include "CommandTrace.h"
+#include "ControllerSnapshot.h"
+#include "EventHistory.h"
 #include "Input.h"
 
+// Build with -DVC_EVENT_HISTORY to keep history as transitions (EventHistory)
+// instead of one CircularBuffer slot per frame. Command results are the same.
 struct VCState {
   uint32_t currentState{ 0 }, prevState{ 0 };
+#ifdef VC_EVENT_HISTORY
+  EventHistory inputHistory;
+#else
   InputFrame inputBuff[MAX_HISTORY];
   int inputBuffNext;
+#endif
+};
+
+// One command evaluation requested from updateRange().
+struct CommandQuery {
+  int frame;      // index into the replayed inputs, queries must be sorted by frame (asserted)
+  int command;
+  bool faceRight;
+  bool result;    // written by updateRange
 };
 
 class VirtualController {
 public:
   VirtualController();
+  explicit VirtualController(const char* commandsPath, CompileMode mode = COMPILE_VALIDATE);
+  // runs off an already compiled set (e.g. CommandLibrary::getCharacter), nothing is compiled
+  explicit VirtualController(const CommandSetView& commands);
+  // runs the matchers tools/CommandCodegen.cpp generated instead of the bytecode VM
+  explicit VirtualController(const GeneratedCommandSet& commands);
   VirtualController(VirtualController &&) = default;
   VirtualController(const VirtualController &) = default;
   VirtualController &operator=(VirtualController &&) = default;
@@ -20,26 +44,66 @@ public:
   ~VirtualController();
 
   void update(uint32_t input);
+  // Rollback resimulation: same end state as calling update() once per input,
+  // but edges are computed in one loop and commands only run for the queries.
+  // Queries outside [0, count) come back false.
+  void updateRange(const uint32_t* inputs, int count, CommandQuery* queries = nullptr, int queryCount = 0);
   bool checkCommand(int index, bool faceRight);
+  int commandCount() const;
 
   VCState save();
   void load(VCState const& state);
 
   std::string printHistory();
 
+  // Sim thread: call once the frame's updates and checks are done.
+  // Sets over SNAPSHOT_MAX_COMMANDS only get their first SNAPSHOT_MAX_COMMANDS hits published.
+  void publish();
+  // Any thread, lock free, returns the last published frame.
+  ControllerSnapshot readSnapshot() const;
+
+  // optional, pass nullptr to detach. Sized to this controller's command count.
+  void setStats(CommandStats* stats);
+
+#ifdef VC_TRACE
+  void setTracing(bool enabled);
+  const TraceRing& getTrace() const;
+#endif
+
 private:
-  bool isPressed(uint32_t input, bool strict = true);
   bool wasPressed(uint32_t input, bool strict = true, bool pressed = true, int offset = 0);
   bool wasPressedBuffer(uint32_t input, bool strict = true, bool pressed = true, int buffLen = 2);
-  bool evalPrefix(const std::vector<CommandIns>& code, int &ip, int &frameOffset);
+  bool evalPrefix(const CommandIns* code, MatchContext& ctx);
+  void skipPrefix(const CommandIns* code, MatchContext& ctx);
+
+  void pushWindows(const InputFrame& frame);
+  void rebuildWindows();
 
   uint32_t cleanSOCD(uint32_t input);
-  bool strictMatch(uint32_t bitsToCheck, uint32_t query);
-  int findMatchingFrame(uint32_t operand, bool strict, bool pressed, int startOffset, int buffLen = 16);
+  InputFrame makeFrame(uint32_t prev, uint32_t curr);
+  void writeFrames(const uint32_t* inputs, int count);
 
   CommandCompiler commandCompiler;
+  const CommandMatcher* matchers{ nullptr }; // generated set, null when running bytecode
 
   // stateful
-  CircularBuffer inputBuffer;
+  InputHistory inputBuffer;
   uint32_t currentState{ 0 }, prevState{ 0 };
+
+  // [k] = everything pressed / released in the last k + 1 frames, for OP_CHORD.
+  // Derived from the history, so load() rebuilds it rather than VCState storing it.
+  uint32_t pressedWindow[CHORD_MAX_WINDOW]{};
+  uint32_t releasedWindow[CHORD_MAX_WINDOW]{};
+
+  uint64_t commandHits[SNAPSHOT_HIT_WORDS]{}; // commands that matched since the last update
+  uint32_t publishCount{ 0 };
+  SnapshotSeqlock snapshot;
+
+  CommandStats* stats{ nullptr };
+
+#ifdef VC_TRACE
+  TraceRing trace;
+  uint32_t traceFrame{ 0 };
+  uint16_t traceCommand{ 0 }; // being checked, for events recorded inside the VM
+#endif
 };
@@ -0,0 +1,63 @@
+// Compile throughput benchmark, reports commands/sec.
+// Build next to the other sources, e.g.
+//   g++ -O2 -std=c++23 -I. bench/CompileBench.cpp CommandCompiler.cpp CommandScanner.cpp
+#include "../CommandCompiler.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// shaped like a modded move list, specials + supers + dashes + normals
+static const char* commandTemplates[] = {
+  "DF",
+  "F, N, F",
+  "B, N, B",
+  "@F, D, DF, LK | ~LK",
+  "~D, DF, F, LK | ~LK",
+  "~D, DB, B, LP",
+  "@~D, N, @D, LP",
+  "@F & !D, N, F",
+  "@B & !D, N, B",
+  "~D, DF, @F & !D, LK | ~LK",
+  "~D, DB, @B & !D, LP | ~LP",
+  "MP & *F",
+  "MP & *B",
+  "~D, DF, F, ~D, DF, F, MP | ~MP",
+  "B, DB, D, DF, F, LK & MK",
+};
+
+int main(int argc, char* argv[]) {
+  const int commandCount = argc > 1 ? std::atoi(argv[1]) : 500;
+  const int iterations = argc > 2 ? std::atoi(argv[2]) : 200;
+  const int templateCount = sizeof(commandTemplates) / sizeof(commandTemplates[0]);
+
+  std::vector<const char*> sources;
+  uint32_t capacity = 0;
+  for (int i = 0; i < commandCount; i++) {
+    sources.push_back(commandTemplates[i % templateCount]);
+    capacity += std::strlen(sources.back()) + 1;
+  }
+
+  std::vector<CommandIns> storage(capacity);
+  CommandArena arena{ storage.data(), capacity, 0 };
+  CommandCompiler compiler;
+  compiler.useArena(&arena);
+
+  // warm up so the command table has its capacity before timing
+  for (const char* source : sources) compiler.compile(source, false);
+
+  const auto start = std::chrono::steady_clock::now();
+  for (int iter = 0; iter < iterations; iter++) {
+    compiler.reset();
+    for (const char* source : sources) compiler.compile(source, false);
+  }
+  const auto end = std::chrono::steady_clock::now();
+
+  const double seconds = std::chrono::duration<double>(end - start).count();
+  const double compiled = double(commandCount) * iterations;
+  printf("compiled %.0f commands (%u instructions per set) in %.3fs\n", compiled, arena.size, seconds);
+  printf("%.0f commands/sec\n", compiled / seconds);
+  return 0;
+}
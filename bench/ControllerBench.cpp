@@ -0,0 +1,201 @@
+// Controller pipeline benchmark, writes JSON results to stdout.
+//   g++ -O2 -std=c++23 -I. bench/ControllerBench.cpp bench/InputGenerator.cpp
+//       VirtualController.cpp CommandCompiler.cpp CommandScanner.cpp CircularBuffer.cpp
+//       CommandStats.cpp CommandTrace.cpp EventHistory.cpp -o controller_bench
+//   ./controller_bench [commands.json] [frames] [max controllers] > results.json
+#include "../VirtualController.h"
+#include "InputGenerator.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+struct BenchResult {
+  std::string benchmark;
+  std::string pattern;
+  int command;     // -1 when not per-command
+  int controllers;
+  uint64_t ops;
+  double nsPerOp;
+};
+
+static volatile uint32_t sink;
+static constexpr int RUNS{ 5 };
+
+// best of RUNS, in nanoseconds
+template <typename F>
+static double bestOf(F&& body) {
+  double best = 1e300;
+  for (int run = 0; run < RUNS; run++) {
+    const auto start = std::chrono::steady_clock::now();
+    body();
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    if (ns < best) best = ns;
+  }
+  return best;
+}
+
+// JSON string literal, paths can hold anything
+static std::string quoted(const char* text) {
+  std::string result = "\"";
+  for (const char* c = text; *c; c++) {
+    if (*c == '"' || *c == '\\') result += '\\';
+    if ((unsigned char)*c < 0x20) {
+      char escape[8];
+      snprintf(escape, sizeof (escape), "\\u%04x", (unsigned char)*c);
+      result += escape;
+      continue;
+    }
+    result += *c;
+  }
+  return result + "\"";
+}
+
+static void writeJson(FILE* out, const char* path, int frames, const std::vector<BenchResult>& results) {
+#ifdef VC_EVENT_HISTORY
+  const char* history = "events";
+#else
+  const char* history = "frames";
+#endif
+  fprintf(out, "{\n  \"commands\": %s,\n  \"frames\": %d,\n  \"history\": \"%s\",\n  \"results\": [\n",
+          quoted(path).c_str(), frames, history);
+  for (size_t i = 0; i < results.size(); i++) {
+    const BenchResult& r = results[i];
+    fprintf(out, "    {\"benchmark\": \"%s\", \"pattern\": \"%s\", \"command\": %d, \"controllers\": %d, "
+                 "\"ops\": %llu, \"ns_per_op\": %.3f}%s\n",
+            r.benchmark.c_str(), r.pattern.c_str(), r.command, r.controllers,
+            (unsigned long long)r.ops, r.nsPerOp, i + 1 < results.size() ? "," : "");
+  }
+  fprintf(out, "  ]\n}\n");
+}
+
+int main(int argc, char* argv[]) {
+  const char* path = argc > 1 ? argv[1] : "./char_def/commands.json";
+  const int frames = argc > 2 ? std::atoi(argv[2]) : 1 << 16;
+  const int maxControllers = argc > 3 ? std::atoi(argv[3]) : 64;
+
+  std::vector<BenchResult> results;
+  InputGenerator generator(0x5eed);
+  std::vector<uint32_t> streams[PATTERN_COUNT];
+  for (int p = 0; p < PATTERN_COUNT; p++) {
+    streams[p].resize(frames);
+    generator.generate((InputPattern)p, streams[p].data(), frames);
+  }
+
+  // full CommandCompiler::init, file read + parse + compile
+  for (CompileMode mode : { COMPILE_VALIDATE, COMPILE_TRUSTED }) {
+    const int inits = 200;
+    CommandCompiler compiler;
+    const double ns = bestOf([&] {
+      for (int i = 0; i < inits; i++) compiler.init(path, mode);
+    });
+    results.push_back({ mode == COMPILE_VALIDATE ? "init_validate" : "init_trusted", "", -1, 1, (uint64_t)inits, ns / inits });
+  }
+
+  VirtualController vc(path);
+  const int commandCount = vc.commandCount();
+
+  for (int p = 0; p < PATTERN_COUNT; p++) {
+    const std::vector<uint32_t>& stream = streams[p];
+    const char* pattern = InputGenerator::patternName((InputPattern)p);
+
+    const double updateNs = bestOf([&] {
+      for (uint32_t input : stream) vc.update(input);
+    });
+    results.push_back({ "update", pattern, -1, 1, (uint64_t)frames, updateNs / frames });
+
+    // checkCommand can't be timed without a history behind it, so it's update + check minus update
+    for (int c = 0; c < commandCount; c++) {
+      const double ns = bestOf([&] {
+        uint32_t hits = 0;
+        for (uint32_t input : stream) {
+          vc.update(input);
+          hits += vc.checkCommand(c, true);
+        }
+        sink = hits;
+      });
+      const double checkNs = ns > updateNs ? (ns - updateNs) / frames : 0.0;
+      results.push_back({ "check_command", pattern, c, 1, (uint64_t)frames, checkNs });
+    }
+  }
+
+  {
+    const int reps = 100000;
+    VCState state = vc.save();
+    const double saveNs = bestOf([&] {
+      for (int i = 0; i < reps; i++) {
+        state = vc.save();
+        sink = state.currentState;
+      }
+    });
+    results.push_back({ "save", "", -1, 1, (uint64_t)reps, saveNs / reps });
+
+    const double loadNs = bestOf([&] {
+      for (int i = 0; i < reps; i++) vc.load(state);
+    });
+    results.push_back({ "load", "", -1, 1, (uint64_t)reps, loadNs / reps });
+  }
+
+  // rollback: load, then resimulate 8 frames for 4 players, with and without final-frame queries
+  {
+    const int players = 4, resimFrames = 8, reps = 20000;
+    std::vector<VirtualController> controllers(players, vc);
+    std::vector<VCState> states;
+    for (VirtualController& controller : controllers) states.push_back(controller.save());
+
+    std::vector<CommandQuery> queries;
+    for (int c = 0; c < commandCount; c++) queries.push_back({ resimFrames - 1, c, true, false });
+
+    for (bool query : { false, true }) {
+      const std::vector<uint32_t>& inputs = streams[PATTERN_MOTION];
+      const double ns = bestOf([&] {
+        for (int r = 0; r < reps; r++) {
+          const uint32_t* span = &inputs[(r * resimFrames) % (frames - resimFrames)];
+          for (int p = 0; p < players; p++) {
+            controllers[p].load(states[p]);
+            controllers[p].updateRange(span, resimFrames, query ? queries.data() : nullptr, query ? (int)queries.size() : 0);
+          }
+        }
+        sink = queries.empty() ? 0 : queries.back().result;
+      });
+      results.push_back({ query ? "rollback_resim_queried" : "rollback_resim", "motion", -1, players, (uint64_t)reps, ns / reps });
+    }
+
+    // the same resimulation frame by frame, for comparison
+    const std::vector<uint32_t>& inputs = streams[PATTERN_MOTION];
+    const double ns = bestOf([&] {
+      for (int r = 0; r < reps; r++) {
+        const uint32_t* span = &inputs[(r * resimFrames) % (frames - resimFrames)];
+        for (int p = 0; p < players; p++) {
+          controllers[p].load(states[p]);
+          for (int f = 0; f < resimFrames; f++) controllers[p].update(span[f]);
+        }
+      }
+    });
+    results.push_back({ "rollback_resim_per_frame", "motion", -1, players, (uint64_t)reps, ns / reps });
+  }
+
+  // a whole frame for n controllers: update, then check every command
+  const std::vector<uint32_t>& stream = streams[PATTERN_MOTION];
+  for (int n = 1; n <= maxControllers; n *= 2) {
+    std::vector<VirtualController> controllers(n, vc);
+    const int scaledFrames = frames / n > 1024 ? frames / n : 1024;
+
+    const double ns = bestOf([&] {
+      uint32_t hits = 0;
+      for (int f = 0; f < scaledFrames; f++) {
+        for (int i = 0; i < n; i++) {
+          // each controller reads the stream from a different spot
+          controllers[i].update(stream[(f + i * 997) % frames]);
+          for (int c = 0; c < commandCount; c++) hits += controllers[i].checkCommand(c, true);
+        }
+      }
+      sink = hits;
+    });
+    results.push_back({ "frame_all_controllers", "motion", -1, n, (uint64_t)scaledFrames, ns / scaledFrames });
+  }
+
+  writeJson(stdout, path, frames, results);
+  return 0;
+}
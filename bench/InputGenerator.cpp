@@ -0,0 +1,108 @@
+#include "InputGenerator.h"
+
+using namespace Input;
+
+static const uint32_t buttons[] = { LIGHT_P, MEDIUM_P, HEAVY_P, LIGHT_K, MEDIUM_K, HEAVY_K };
+
+// numpad notation, facing right
+static const uint32_t qcf[] = { DOWN, DOWNRIGHT, RIGHT };
+static const uint32_t qcb[] = { DOWN, DOWNLEFT, LEFT };
+static const uint32_t dp[] = { RIGHT, DOWN, DOWNRIGHT };
+static const uint32_t dash[] = { RIGHT, 0, RIGHT };
+static const uint32_t backdash[] = { LEFT, 0, LEFT };
+static const uint32_t hcb[] = { RIGHT, DOWNRIGHT, DOWN, DOWNLEFT, LEFT };
+
+struct Motion {
+  const uint32_t* dirs;
+  int length;
+};
+
+static const Motion motions[] = {
+  { qcf, 3 }, { qcb, 3 }, { dp, 3 }, { dash, 3 }, { backdash, 3 }, { hcb, 5 },
+};
+
+InputGenerator::InputGenerator(uint32_t seed) : state(seed ? seed : 1) {}
+
+// xorshift32, plenty for input noise
+uint32_t InputGenerator::next() {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+uint32_t InputGenerator::randomButton() {
+  return buttons[next() % (sizeof(buttons) / sizeof(buttons[0]))];
+}
+
+// writes one motion + button, returns frames written
+int InputGenerator::motion(uint32_t* out, int frames) {
+  int written = 0;
+  auto hold = [&](uint32_t input, int count) {
+    for (int i = 0; i < count && written < frames; i++) out[written++] = input;
+  };
+
+  if (next() % 4 == 0) {
+    // charge: back for 45+ frames, then forward + button
+    hold(LEFT, 45 + next() % 15);
+    const uint32_t button = randomButton();
+    hold(RIGHT | button, 1 + next() % 3);
+  } else {
+    const Motion& m = motions[next() % (sizeof(motions) / sizeof(motions[0]))];
+    for (int i = 0; i < m.length; i++) {
+      hold(m.dirs[i], 1 + next() % 3);
+    }
+    const uint32_t last = m.dirs[m.length - 1];
+    hold(last | randomButton(), 1 + next() % 4);
+  }
+  hold(0, next() % 12);
+  return written;
+}
+
+void InputGenerator::generate(InputPattern pattern, uint32_t* out, int frames) {
+  int i = 0;
+  while (i < frames) {
+    switch (pattern) {
+      case PATTERN_MASH:
+        out[i++] = next() & (DIR_MASK | LIGHT_P | MEDIUM_P | HEAVY_P | LIGHT_K | MEDIUM_K | HEAVY_K);
+        break;
+      case PATTERN_MOTION:
+        i += motion(out + i, frames - i);
+        break;
+      case PATTERN_IDLE: {
+        // mostly nothing, now and then walk or block for a while
+        uint32_t input = 0;
+        const uint32_t roll = next() % 100;
+        if (roll < 10) input = LEFT;
+        else if (roll < 15) input = RIGHT;
+        else if (roll < 18) input = DOWNLEFT;
+        else if (roll < 20) input = randomButton();
+        const int length = 10 + next() % 50;
+        for (int f = 0; f < length && i < frames; f++) out[i++] = input;
+        break;
+      }
+      case PATTERN_SOCD: {
+        uint32_t input = next() & DIR_MASK;
+        if (next() % 2) input |= HORIZONTAL_SOCD;
+        if (next() % 4 == 0) input |= VERTICAL_SOCD;
+        if (next() % 3 == 0) input |= randomButton();
+        const int length = 1 + next() % 4;
+        for (int f = 0; f < length && i < frames; f++) out[i++] = input;
+        break;
+      }
+      default:
+        out[i++] = 0;
+        break;
+    }
+  }
+}
+
+const char* InputGenerator::patternName(InputPattern pattern) {
+  switch (pattern) {
+    case PATTERN_MASH:   return "mash";
+    case PATTERN_MOTION: return "motion";
+    case PATTERN_IDLE:   return "idle";
+    case PATTERN_SOCD:   return "socd";
+    default:             return "unknown";
+  }
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdint>
+#include "../Input.h"
+
+// Deterministic synthetic input streams, raw words as a pad would report them
+// (before SOCD cleaning). Same seed, same stream.
+enum InputPattern {
+  PATTERN_MASH,   // random buttons and directions, changes nearly every frame
+  PATTERN_MOTION, // motions (236, 623, 214, dashes, charge) into a button, with neutral gaps
+  PATTERN_IDLE,   // long holds and empty frames, what most of a real match looks like
+  PATTERN_SOCD,   // hitbox style, opposing cardinals held together
+  PATTERN_COUNT
+};
+
+class InputGenerator {
+public:
+  explicit InputGenerator(uint32_t seed);
+
+  void generate(InputPattern pattern, uint32_t* out, int frames);
+  static const char* patternName(InputPattern pattern);
+
+private:
+  uint32_t next();
+  uint32_t randomButton();
+  int motion(uint32_t* out, int frames);
+
+  uint32_t state;
+};
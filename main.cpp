@@ -3,8 +3,12 @@
 
 uint32_t fetchUserInput();
 
+// commands.json compiled ahead of time, regenerate ShippedCommands.cpp after editing it:
+//   ./command_codegen commands.json shippedCommands ShippedCommands.cpp
+DECLARE_GENERATED_COMMANDS(shippedCommands);
+
 int main (int argc, char *argv[]) {
-  VirtualController vc;
+  VirtualController vc(shippedCommands);
   // game loop
   while (true) {
     int userInput = fetchUserInput();
@@ -0,0 +1,154 @@
+// Replays synthetic input through a generated command set and the bytecode VM
+// side by side and reports every frame where they disagree.
+//   ./command_codegen tools/check_commands.json generatedCommands Generated.cpp
+//   g++ -O2 -std=c++23 -I. tools/CheckGenerated.cpp Generated.cpp bench/InputGenerator.cpp
+//       VirtualController.cpp CommandCompiler.cpp CommandScanner.cpp CircularBuffer.cpp
+//       CommandStats.cpp CommandTrace.cpp EventHistory.cpp -o check_generated
+//   ./check_generated [frames]
+// Build with -DVC_GENERATED_SET=<symbol> when the set isn't called generatedCommands.
+// tools/check_commands.json covers every opcode and modifier; the VM's clause
+// ordering is also checked on its own, that's something equivalence can't see.
+#include "../VirtualController.h"
+#include "../bench/InputGenerator.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#ifndef VC_GENERATED_SET
+#define VC_GENERATED_SET generatedCommands
+#endif
+
+DECLARE_GENERATED_COMMANDS(VC_GENERATED_SET);
+
+static constexpr int MAX_REPORTED{ 20 };
+static constexpr int LOAD_EVERY{ 97 }; // frames between save/load round trips
+
+static volatile uint32_t sink;
+
+struct OrderingCase {
+  const char* command;
+  std::vector<uint32_t> inputs; // oldest first
+  bool expected;
+  int latency;                  // frames since the command's last input, when it matches
+};
+
+// Clauses have to come in order, a chord included, whatever the bytecode does.
+static int checkOrdering() {
+  using namespace Input;
+  const OrderingCase cases[] = {
+    { "F, [LP LK]",            { 0, RIGHT, 0, LIGHT_P | LIGHT_K },                        true, 0 },
+    { "F, [LP LK]",            { 0, LIGHT_P | LIGHT_K, 0, RIGHT },                        false, 0 },
+    { "~D, DF, F, 2[MP MK]",   { 0, DOWN, DOWNRIGHT, RIGHT, RIGHT | MEDIUM_P | MEDIUM_K }, true, 0 },
+    { "~D, DF, F, 2[MP MK]",   { 0, DOWN, DOWNRIGHT, DOWNRIGHT | MEDIUM_P | MEDIUM_K, RIGHT }, false, 0 },
+    { "3[LP LK]",              { 0, LIGHT_P, LIGHT_P | LIGHT_K, 0, 0 },                   true, 2 },
+    { "3[LP LK]",              { 0, LIGHT_P, 0, 0, LIGHT_K },                             false, 0 },
+  };
+
+  int failures = 0;
+  for (const OrderingCase& c : cases) {
+    CommandIns storage[64];
+    CommandArena arena{ storage, 64, 0 };
+    CommandCompiler compiler;
+    compiler.useArena(&arena);
+    compiler.compile(c.command, false);
+
+    VirtualController vm(compiler.view());
+    CommandStats stats;
+    vm.setStats(&stats);
+    for (uint32_t input : c.inputs) vm.update(input);
+
+    const bool matched = vm.checkCommand(0, true);
+    int latency = 0;
+    while (latency < LATENCY_BUCKETS - 1 && stats.counters[0].latency[latency] == 0) latency++;
+    if (matched != c.expected || (matched && latency != c.latency)) {
+      failures++;
+      fprintf(stderr, "ordering: \"%s\" gave %d latency %d, expected %d latency %d\n",
+              c.command, matched, latency, c.expected, c.latency);
+    }
+  }
+  return failures;
+}
+
+// nanoseconds per checkCommand over every command on every frame
+static double timeChecks(VirtualController& controller, const std::vector<uint32_t>& inputs) {
+  const int commands = controller.commandCount();
+  uint32_t hits = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (uint32_t input : inputs) {
+    controller.update(input);
+    for (int c = 0; c < commands; c++) {
+      hits += controller.checkCommand(c, true);
+    }
+  }
+  const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  sink = hits;
+  return ns / ((double)inputs.size() * commands);
+}
+
+int main(int argc, char* argv[]) {
+  const int frames = argc > 1 ? std::atoi(argv[1]) : 1 << 16;
+  const GeneratedCommandSet& set = VC_GENERATED_SET;
+  const int commands = set.bytecode.count;
+
+  VirtualController vm(set.bytecode);
+  VirtualController generated(set);
+  CommandStats vmStats, generatedStats;
+  vm.setStats(&vmStats);
+  generated.setStats(&generatedStats);
+
+  InputGenerator generator(1);
+  std::vector<uint32_t> inputs(frames);
+  int mismatches = 0;
+  uint64_t checks = 0;
+
+  for (int p = 0; p < PATTERN_COUNT; p++) {
+    const InputPattern pattern = (InputPattern)p;
+    generator.generate(pattern, inputs.data(), frames);
+
+    for (int frame = 0; frame < frames; frame++) {
+      vm.update(inputs[frame]);
+      generated.update(inputs[frame]);
+
+      // rollback every so often, both should come back to the same place
+      if (frame % LOAD_EVERY == LOAD_EVERY - 1) {
+        const VCState state = vm.save();
+        vm.load(state);
+        generated.load(state);
+      }
+
+      for (int c = 0; c < commands; c++) {
+        const bool expected = vm.checkCommand(c, true);
+        const bool actual = generated.checkCommand(c, true);
+        checks++;
+        if (expected == actual) continue;
+        if (mismatches++ < MAX_REPORTED)
+          fprintf(stderr, "%s frame %d command %d: vm %d, generated %d\n",
+                  InputGenerator::patternName(pattern), frame, c, expected, actual);
+      }
+    }
+  }
+
+  // same evaluation order means the same instructions, probes and latencies
+  int statMismatches = 0;
+  for (int c = 0; c < commands; c++) {
+    if (std::memcmp(&vmStats.counters[c], &generatedStats.counters[c], sizeof (CommandCounters)) != 0) {
+      if (statMismatches++ < MAX_REPORTED)
+        fprintf(stderr, "command %d: stats differ\n", c);
+    }
+  }
+
+  vm.setStats(nullptr);
+  generated.setStats(nullptr);
+  generator.generate(PATTERN_MOTION, inputs.data(), frames);
+  const double vmNs = timeChecks(vm, inputs);
+  const double generatedNs = timeChecks(generated, inputs);
+
+  const int orderingFailures = checkOrdering();
+
+  printf("%s: %d commands, %llu checks, %d mismatches, %d stat mismatches, %d ordering failures\n",
+         set.source, commands, (unsigned long long)checks, mismatches, statMismatches, orderingFailures);
+  printf("checkCommand: vm %.2f ns, generated %.2f ns\n", vmNs, generatedNs);
+  return mismatches == 0 && statMismatches == 0 && orderingFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,235 @@
+// Compiles a commands.json ahead of time into a C++ translation unit with one
+// straight-line matcher per command, for characters that ship with the game.
+//   g++ -std=c++23 -I. tools/CommandCodegen.cpp CommandCompiler.cpp CommandScanner.cpp -o command_codegen
+//   ./command_codegen char_def/ryu.json ryuCommands RyuCommands.cpp
+// Link RyuCommands.cpp in, declare the set with DECLARE_GENERATED_COMMANDS(ryuCommands) and
+// construct VirtualController(ryuCommands), nothing is compiled at runtime.
+// Check the output against the bytecode VM with tools/CheckGenerated.cpp.
+#include "../CommandCompiler.h"
+#include "../CommandVm.h"
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <glaze/glaze.hpp>
+
+static std::string hex(uint32_t value) {
+  char buff[16];
+  snprintf(buff, sizeof (buff), "0x%Xu", value);
+  return buff;
+}
+
+// Emits the bytecode the VM would run as C++, keeping its evaluation order and
+// side effects (frame offset, probe and instruction counts) so results and
+// CommandStats come out identical.
+class MatcherWriter {
+public:
+  explicit MatcherWriter(std::string& out) : out(out) {}
+
+  void command(const CommandIns* code) {
+    int ip = 0;
+    bool first = true;
+    line("int f = 0;");
+    while (code[ip].opcode != OP_END) {
+      const std::string clause = node(code, ip);
+      line("if (!" + clause + ") { ctx.ip = " + std::to_string(ip) + "; ctx.frameOffset = f; return false; }");
+      if (first) line("ctx.latency = f;");
+      first = false;
+    }
+    line("ctx.ip = " + std::to_string(ip) + ";");
+    line("ctx.frameOffset = f;");
+    line("return true;");
+  }
+
+private:
+  // Writes one prefix subtree, returns the variable holding its value.
+  std::string node(const CommandIns* code, int& ip) {
+    const CommandIns ins = code[ip++];
+    const uint32_t operand = ins.operand & OP_MASK;
+    const bool negated = (ins.operand & NOT_FLAG) != 0;
+    const char* strict = (ins.operand & ANY_FLAG) ? "false" : "true";
+    const std::string t = "t" + std::to_string(temps++);
+
+    switch (ins.opcode) {
+      case OP_PRESS:
+      case OP_RELEASE: {
+        const std::string m = "m" + std::to_string(temps++);
+        line("const int " + m + " = matchFind(ctx, " + hex(operand) + ", " + strict + ", "
+             + (ins.opcode == OP_PRESS ? "true" : "false") + ", f);");
+        line("const bool " + t + " = " + m + " >= 0;");
+        line("f = " + t + " ? " + m + " : f;");
+        break;
+      }
+      case OP_HOLD:
+        line("const bool " + t + " = matchHeld(ctx.currentState, " + hex(operand) + ", " + strict + ");");
+        break;
+      case OP_CHORD: {
+        const std::string m = "m" + std::to_string(temps++);
+        line("const int " + m + " = matchChord(ctx, " + hex(operand) + ", f);");
+        line("const bool " + t + " = " + m + " >= 0;");
+        line("f = " + t + " ? " + m + " : f;");
+        break;
+      }
+      case OP_AND: {
+        const std::string left = node(code, ip);
+        const int rightLength = subtreeLength(code, ip);
+        line("bool " + t + " = false;");
+        line("if (" + left + ") {");
+        depth++;
+        const std::string right = node(code, ip);
+        line(t + " = " + right + ";");
+        depth--;
+        line("} else {");
+        line("  ctx.skipped += " + std::to_string(rightLength) + ";");
+        line("}");
+        break;
+      }
+      case OP_OR: {
+        // no short-circuit, the right side's frame offset still counts
+        const std::string left = node(code, ip);
+        const std::string right = node(code, ip);
+        line("const bool " + t + " = " + left + " | " + right + ";");
+        break;
+      }
+      default:
+        throw std::runtime_error("can't generate code for opcode " + std::to_string(ins.opcode));
+    }
+
+    if (!negated) return t;
+    const std::string n = "t" + std::to_string(temps++);
+    line("const bool " + n + " = !" + t + ";");
+    return n;
+  }
+
+  static int subtreeLength(const CommandIns* code, int ip) {
+    int pending = 1, length = 0;
+    while (pending > 0) {
+      const CommandOp op = code[ip + length++].opcode;
+      pending += (op == OP_AND || op == OP_OR) ? 1 : -1;
+    }
+    return length;
+  }
+
+  void line(const std::string& text) {
+    out.append(2 * depth, ' ');
+    out += text;
+    out += '\n';
+  }
+
+  std::string& out;
+  int depth = 1;
+  int temps = 0;
+};
+
+static std::string quoted(const std::string& text) {
+  std::string result = "\"";
+  for (char c : text) {
+    if (c == '"' || c == '\\') result += '\\';
+    if (c == '\n') { result += "\\n"; continue; }
+    result += c;
+  }
+  return result + "\"";
+}
+
+static std::string singleLine(std::string text) {
+  for (char& c : text) {
+    if (c == '\n' || c == '\r') c = ' ';
+  }
+  return text;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s <commands.json> <symbol> [out.cpp]\n", argv[0]);
+    return 1;
+  }
+  const char* path = argv[1];
+  const std::string symbol = argv[2];
+
+  CommandCompiler compiler;
+  RootJson json;
+  try {
+    // same checks as loading at runtime, a bad file never gets generated
+    compiler.init(path);
+
+    std::ifstream file(path);
+    std::string jsonBuff((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    auto parsed = glz::read_json<RootJson>(jsonBuff);
+    if (!parsed)
+      throw std::runtime_error("Failed to parse " + std::string(path) + ": " + glz::format_error(parsed.error(), jsonBuff));
+    json = std::move(*parsed);
+  } catch (const std::exception& e) {
+    fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+
+  const CommandSetView set = compiler.view();
+  if (set.count == 0) {
+    fprintf(stderr, "%s has no commands\n", path);
+    return 1;
+  }
+
+  std::string out;
+  out += "// Generated by tools/CommandCodegen.cpp from " + singleLine(path) + ", do not edit.\n";
+  out += "// Build with the same VC_EVENT_HISTORY setting as VirtualController.cpp, it won't link otherwise.\n";
+  out += "#include \"CommandMatch.h\"\n\n";
+
+  uint32_t instructionCount = 0;
+  try {
+    for (int i = 0; i < set.count; i++) {
+      const CommandCode& code = set.codes[i];
+      const CommandJson& source = json.commands[i];
+      out += "// " + std::to_string(i) + " " + singleLine(source.name) + ": " + singleLine(source.command) + "\n";
+      out += "static bool match" + std::to_string(i) + "(MatchContext& ctx) {\n";
+      MatcherWriter(out).command(set.instructions + code.offset);
+      out += "}\n\n";
+      instructionCount = std::max(instructionCount, code.offset + code.length);
+    }
+  } catch (const std::exception& e) {
+    fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+
+  out += "static const CommandMatcher matchers[] = {\n";
+  for (int i = 0; i < set.count; i++) {
+    out += "  match" + std::to_string(i) + ",\n";
+  }
+  out += "};\n\n";
+
+  // the bytecode goes along so indices, commandCount and the VM fallback stay available
+  out += "static const CommandIns instructions[] = {\n";
+  for (uint32_t i = 0; i < instructionCount; i++) {
+    out += "  { " + compiler.opcodeToString(set.instructions[i].opcode) + ", " + hex(set.instructions[i].operand) + " },\n";
+  }
+  out += "};\n\n";
+
+  out += "static const CommandCode codes[] = {\n";
+  for (int i = 0; i < set.count; i++) {
+    const CommandCode& code = set.codes[i];
+    out += "  { " + std::to_string(code.offset) + ", " + std::to_string(code.length) + ", "
+      + (code.clears ? "true" : "false") + " },\n";
+  }
+  out += "};\n\n";
+
+  // in the history mode's namespace, like DECLARE_GENERATED_COMMANDS declares it
+  out += "inline namespace MATCH_HISTORY_NAMESPACE {\n\n";
+  out += "extern const GeneratedCommandSet " + symbol + " = {\n";
+  out += "  matchers,\n";
+  out += "  { codes, instructions, " + std::to_string(set.count) + " },\n";
+  out += "  " + quoted(path) + ",\n";
+  out += "};\n\n";
+  out += "} // namespace MATCH_HISTORY_NAMESPACE\n";
+
+  if (argc > 3) {
+    std::ofstream file(argv[3], std::ios::binary);
+    if (!file || !(file << out)) {
+      fprintf(stderr, "can't write %s\n", argv[3]);
+      return 1;
+    }
+  } else {
+    fwrite(out.data(), 1, out.size(), stdout);
+  }
+  return 0;
+}
@@ -0,0 +1,35 @@
+// Compiles a roster into a shared CommandLibrary segment for match processes to attach to.
+//   g++ -std=c++23 -I. tools/PublishLibrary.cpp CommandLibrary.cpp CommandCompiler.cpp CommandScanner.cpp -o publish_library
+//   ./publish_library /vc_commands ryu=char_def/ryu.json ken=char_def/ken.json
+#include "../CommandLibrary.h"
+#include <cstdio>
+#include <exception>
+#include <string>
+#include <vector>
+
+int main(int argc, char* argv[]) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s <segment name> <character>=<commands.json>...\n", argv[0]);
+    return 1;
+  }
+
+  std::vector<RosterEntry> roster;
+  for (int i = 2; i < argc; i++) {
+    const std::string arg = argv[i];
+    const size_t split = arg.find('=');
+    if (split == std::string::npos) {
+      fprintf(stderr, "expected <character>=<commands.json>, got %s\n", argv[i]);
+      return 1;
+    }
+    roster.push_back({ arg.substr(0, split), arg.substr(split + 1) });
+  }
+
+  try {
+    CommandLibrary::publish(argv[1], roster);
+  } catch (const std::exception& e) {
+    fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+  printf("published %zu characters to %s\n", roster.size(), argv[1]);
+  return 0;
+}
@@ -0,0 +1,32 @@
+// Turns a TraceRing::dump() file into a readable timeline.
+//   g++ -std=c++23 -I. tools/TraceDecode.cpp CommandTrace.cpp -o trace_decode
+//   ./trace_decode p1.trace
+#include "../CommandTrace.h"
+#include <cstdio>
+#include <vector>
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <trace dump>\n", argv[0]);
+    return 1;
+  }
+
+  FILE* file = fopen(argv[1], "rb");
+  if (!file) {
+    fprintf(stderr, "can't open %s\n", argv[1]);
+    return 1;
+  }
+
+  std::vector<TraceEvent> events;
+  uint32_t dropped = 0;
+  const bool ok = readTrace(file, events, &dropped);
+  fclose(file);
+  if (!ok) {
+    fprintf(stderr, "%s is not a trace dump\n", argv[1]);
+    return 1;
+  }
+
+  if (dropped) printf("(%u older events were overwritten)\n", dropped);
+  printTimeline(stdout, events);
+  return 0;
+}